@@ -0,0 +1,126 @@
+#ifndef NRFZBCPP_HOST_BENCH_HPP_
+#define NRFZBCPP_HOST_BENCH_HPP_
+
+//Minimal microbenchmark harness for NrfZBCpp_bench.
+//A benchmark is a function registered with ZB_BENCH; it calls ctx.run(label, body) for every
+//measured operation. The body is repeated until the run takes long enough, the result is per call of body.
+//ctx.compare(what, inputs, impl_t{...}, impl_t{...}) times an implementation against the one it replaced.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace zb_bench
+{
+    inline uint64_t cycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t v;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+        return v;
+#else
+        return 0;
+#endif
+    }
+
+    template<class T>
+    inline void do_not_optimize(T const& v) { asm volatile("" : : "r,m"(v) : "memory"); }
+    inline void clobber() { asm volatile("" : : : "memory"); }
+
+    //one of the implementations compared by ctx_t::compare: f(input) returns something comparable with ==
+    template<class F>
+    struct impl_t
+    {
+        const char *name;
+        F f;
+    };
+
+    struct ctx_t
+    {
+        bool quick = false;//smoke run: a handful of iterations, no meaningful numbers
+        const char *filter = nullptr;
+
+        template<class F>
+        void run(const char *label, F &&body)
+        {
+            using clock = std::chrono::steady_clock;
+            const auto kMinTime = quick ? std::chrono::microseconds(200) : std::chrono::microseconds(100000);
+            body();//warm up
+            for(uint64_t n = 1;; n *= 2)
+            {
+                auto t0 = clock::now();
+                uint64_t c0 = cycles();
+                for(uint64_t i = 0; i < n; ++i)
+                    body();
+                uint64_t c1 = cycles();
+                auto t1 = clock::now();
+                if (t1 - t0 >= kMinTime || n >= (uint64_t(1) << 40))
+                {
+                    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / double(n);
+                    double cy = double(c1 - c0) / double(n);
+                    printf("  %-56s %10.2f ns %12.1f cycles\n", label, ns, cy);
+                    return;
+                }
+            }
+        }
+
+        //both implementations must give the same result for every input (checked once, untimed),
+        //then each is timed as "<name>, <what>" with one run going over all the inputs
+        template<class Inputs, class Cur, class Prev>
+        void compare(const char *what, Inputs const& inputs, impl_t<Cur> cur, impl_t<Prev> prev)
+        {
+            size_t i = 0;
+            for(auto const& in : inputs)
+            {
+                if (!(cur.f(in) == prev.f(in)))
+                {
+                    printf("  %s: %s and %s differ at input %zu\n", what, cur.name, prev.name, i);
+                    std::abort();
+                }
+                ++i;
+            }
+            auto time = [&](auto &impl){
+                char label[64];
+                snprintf(label, sizeof(label), "%s, %s", impl.name, what);
+                run(label, [&]{
+                    for(auto const& in : inputs)
+                        do_not_optimize(impl.f(in));
+                });
+            };
+            time(cur);
+            time(prev);
+        }
+    };
+
+    struct bench_t
+    {
+        const char *name;
+        void (*fn)(ctx_t &);
+
+        static std::vector<bench_t>& all()
+        {
+            static std::vector<bench_t> g_All;
+            return g_All;
+        }
+
+        struct registrar_t
+        {
+            registrar_t(const char *name, void (*fn)(ctx_t &)) { all().push_back({name, fn}); }
+        };
+    };
+}
+
+#define ZB_BENCH(name) \
+    static void name(zb_bench::ctx_t &ctx); \
+    static zb_bench::bench_t::registrar_t g_##name##_registrar{#name, &name}; \
+    static void name([[maybe_unused]] zb_bench::ctx_t &ctx)
+
+#endif
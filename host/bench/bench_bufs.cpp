@@ -0,0 +1,98 @@
+//Pre-allocated command buffers (pre_alloc_zb_bufs_out): 2, 16 and 64 buffers all taken, then returned in reverse order
+#include "bench.hpp"
+#include <zb_host.hpp>
+#include "nrfzbcpp/zb_buf.hpp"
+#include <utility>
+
+namespace
+{
+    //the pool before the bitmap: a linear scan for a filled or an empty slot
+    template<size_t N>
+    struct linear_zb_bufs_out
+    {
+        int init()
+        {
+            for(size_t i = 0; i < N; ++i)
+            {
+                if ((bufs[i] = zb_buf_get_out()) == ZB_BUF_INVALID)
+                    return int(N - i);
+            }
+            return 0;
+        }
+
+        zb_bufid_t allocate()
+        {
+            for(size_t i = 0; i < N; ++i)
+            {
+                if (bufs[i] != ZB_BUF_INVALID)
+                    return std::exchange(bufs[i], ZB_BUF_INVALID);
+            }
+            return ZB_BUF_INVALID;
+        }
+
+        void deallocate(zb_bufid_t buf)
+        {
+            for(size_t i = 0; i < N; ++i)
+            {
+                if (bufs[i] == ZB_BUF_INVALID)
+                {
+                    bufs[i] = buf;
+                    zb_buf_reuse(buf);
+                    return;
+                }
+            }
+            ZB_ASSERT(false);
+        }
+
+        void free()
+        {
+            for(size_t i = 0; i < N; ++i)
+            {
+                if (bufs[i] != ZB_BUF_INVALID)
+                    zb_buf_free(std::exchange(bufs[i], ZB_BUF_INVALID));
+            }
+        }
+    private:
+        zb_bufid_t bufs[N]{};
+    };
+
+    //returns how many buffers it got
+    template<size_t N, class Pool>
+    size_t out_and_back(Pool &p)
+    {
+        zb_bufid_t taken[N];
+        size_t got = 0;
+        for(size_t i = 0; i < N; ++i)
+            got += (taken[i] = p.allocate()) != ZB_BUF_INVALID;
+        for(size_t i = N; i > 0; --i)
+        {
+            if (taken[i - 1] != ZB_BUF_INVALID)
+                p.deallocate(taken[i - 1]);
+        }
+        return got;
+    }
+
+    template<size_t N>
+    void bench_bufs_n(zb_bench::ctx_t &ctx)
+    {
+        static_assert(N * 2 <= zb_host::kMaxBufs);
+        static zb::pre_alloc_zb_bufs_out<N> bitmap;
+        static linear_zb_bufs_out<N> linear;
+        ZB_ASSERT(bitmap.init() == 0 && linear.init() == 0);
+        constexpr int kOnce[] = {0};
+        char what[32];
+        snprintf(what, sizeof(what), "%zu bufs", N);
+        ctx.compare(what, kOnce,
+                zb_bench::impl_t{"bitmap", [](int){ return out_and_back<N>(bitmap); }},
+                zb_bench::impl_t{"linear", [](int){ return out_and_back<N>(linear); }});
+        bitmap.free();
+        linear.free();
+    }
+}
+
+ZB_BENCH(cmd_bufs)
+{
+    bench_bufs_n<2>(ctx);
+    bench_bufs_n<16>(ctx);
+    bench_bufs_n<64>(ctx);
+}
@@ -0,0 +1,92 @@
+//Received command lookup (cluster_commands_desc_t::find_cmd_handler): every id of 4, 32 and 128 commands and a miss
+#include "bench.hpp"
+#include <zb_host.hpp>
+#include "nrfzbcpp/zb_main.hpp"
+#include <utility>
+
+namespace zb
+{
+    //scattered ids: 37 is coprime with 256, so the ids of up to 256 commands are unique
+    template<size_t I>
+    constexpr uint8_t kBenchCmdId = uint8_t(I * 37 + 5);
+
+    //one base per command: the member pointers to the bases' 'cmd' apply to the derived cluster struct as is
+    template<size_t I>
+    struct bench_cmd_holder_t { cmd_in_t<kBenchCmdId<I>, uint8_t> cmd; };
+
+    template<class Seq> struct bench_many_cmds_base_t;
+    template<size_t... I>
+    struct bench_many_cmds_base_t<std::index_sequence<I...>>: bench_cmd_holder_t<I>... {};
+
+    template<size_t N>
+    struct bench_many_cmds_t: bench_many_cmds_base_t<std::make_index_sequence<N>>
+    {
+        uint8_t value;
+    };
+
+    template<size_t N>
+    struct zcl_description_t<bench_many_cmds_t<N>>
+    {
+        static constexpr auto get()
+        {
+            using T = bench_many_cmds_t<N>;
+            return []<size_t... I>(std::index_sequence<I...>){
+                return cluster_t<
+                    {.id = 0xfc20},
+                    attributes_t<attribute_t{.m = &T::value, .id = 0x0000, .a = access_t::Read}>{},
+                    commands_t<&bench_cmd_holder_t<I>::cmd...>{}
+                >{};
+            }(std::make_index_sequence<N>{});
+        }
+    };
+}
+
+namespace
+{
+    //the lookup before the dispatch table: a fold over every command member
+    template<size_t N>
+    zb::raw_handler_result_t fold_find_cmd_handler(uint8_t id, zb::bench_many_cmds_t<N> *pStruct)
+    {
+        return [&]<size_t... I>(std::index_sequence<I...>){
+            zb::raw_handler_result_t res;
+            bool found = false;
+            auto check = [&]<class CmdType>(CmdType *pF){
+                if constexpr (CmdType::is_received())
+                {
+                    if (!found && pF->kCmdId == id)
+                    {
+                        res.field = pF;
+                        res.h = &pF->raw_handler;
+                        found = true;
+                    }
+                }
+            };
+            (check(&(pStruct->*&zb::bench_cmd_holder_t<I>::cmd)),...);
+            return res;
+        }(std::make_index_sequence<N>{});
+    }
+
+    template<size_t N>
+    void bench_lookup(zb_bench::ctx_t &ctx)
+    {
+        using T = zb::bench_many_cmds_t<N>;
+        using desc_t = decltype(zb::zcl_description_t<T>::get());
+        static T s{};
+        //every received id in turn, then a miss
+        static uint8_t ids[N + 1];
+        [&]<size_t... I>(std::index_sequence<I...>){ ((ids[I] = zb::kBenchCmdId<I>), ...); }(std::make_index_sequence<N>{});
+        ids[N] = uint8_t(zb::kBenchCmdId<N>);
+        char what[32];
+        snprintf(what, sizeof(what), "%zu cmds", N);
+        ctx.compare(what, ids,
+                zb_bench::impl_t{"table", [](uint8_t id){ auto r = desc_t::find_cmd_handler(id, &s); return std::pair{r.h, r.field}; }},
+                zb_bench::impl_t{"fold", [](uint8_t id){ auto r = fold_find_cmd_handler<N>(id, &s); return std::pair{r.h, r.field}; }});
+    }
+}
+
+ZB_BENCH(cmd_dispatch)
+{
+    bench_lookup<4>(ctx);
+    bench_lookup<32>(ctx);
+    bench_lookup<128>(ctx);
+}
@@ -0,0 +1,48 @@
+//tpl_device_cb: attribute write notification dispatch through the compile-time handler table
+//Needs function pointers inside class-type template arguments: not built with gcc < 13 (see host/CMakeLists.txt)
+#include "bench.hpp"
+#include <zb_host.hpp>
+#include "nrfzbcpp/zb_main.hpp"
+
+namespace
+{
+    uint32_t g_Calls = 0;
+    void on_set(zb_zcl_set_attr_value_param_t*, zb_zcl_device_callback_param_t*) { ++g_Calls; }
+
+    struct handlers_t
+    {
+        static constexpr zb::set_attr_val_gen_desc_t kOnOff{{.ep = 1, .cluster = ZB_ZCL_CLUSTER_ID_ON_OFF, .attribute = 0x0000}, &on_set};
+        static constexpr zb::set_attr_val_gen_desc_t kLevel{{.ep = 1, .cluster = ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL, .attribute = 0x0000}, &on_set};
+        static constexpr zb::set_attr_val_gen_desc_t kIdentify{{.ep = 1, .cluster = ZB_ZCL_CLUSTER_ID_IDENTIFY, .attribute = 0x0000}, &on_set};
+        static constexpr zb::set_attr_val_gen_desc_t kOnOff2{{.ep = 2, .cluster = ZB_ZCL_CLUSTER_ID_ON_OFF, .attribute = 0x0000}, &on_set};
+        static constexpr zb::set_attr_val_gen_desc_t kAnyOnEp2{{.ep = 2}, &on_set};
+    };
+
+    constexpr auto kDevCb = &zb::tpl_device_cb<{}, handlers_t::kOnOff, handlers_t::kLevel, handlers_t::kIdentify, handlers_t::kOnOff2, handlers_t::kAnyOnEp2>;
+
+    zb_bufid_t make_set_attr_buf(uint8_t ep, uint16_t cluster, uint16_t attr)
+    {
+        zb_bufid_t buf = zb_buf_get_out();
+        auto *p = ZB_BUF_GET_PARAM(buf, zb_zcl_device_callback_param_t);
+        *p = {};
+        p->device_cb_id = ZB_ZCL_SET_ATTR_VALUE_CB_ID;
+        p->endpoint = ep;
+        p->cb_param.set_attr_value_param.cluster_id = cluster;
+        p->cb_param.set_attr_value_param.attr_id = attr;
+        return buf;
+    }
+}
+
+ZB_BENCH(device_cb)
+{
+    zb_bufid_t exact = make_set_attr_buf(1, ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL, 0x0000);
+    ctx.run("tpl_device_cb (exact key, 5 handlers)", [&]{ kDevCb(exact); });
+    zb_bufid_t wildcard = make_set_attr_buf(2, ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL, 0x0000);
+    ctx.run("tpl_device_cb (wildcard only)", [&]{ kDevCb(wildcard); });
+    zb_bufid_t none = make_set_attr_buf(3, ZB_ZCL_CLUSTER_ID_BASIC, 0x0000);
+    ctx.run("tpl_device_cb (no handler)", [&]{ kDevCb(none); });
+    zb_bench::do_not_optimize(g_Calls);
+    zb_buf_free(exact);
+    zb_buf_free(wildcard);
+    zb_buf_free(none);
+}
@@ -0,0 +1,102 @@
+//Hot paths of a device: received command dispatch, command sending, alarm arming
+#include "bench.hpp"
+#include <zb_host.hpp>
+#include "nrfzbcpp/zb_main.hpp"
+
+namespace zb
+{
+    struct bench_cluster_t
+    {
+        uint16_t value;
+        cmd_in_t<0x00, uint8_t> in0;
+        cmd_in_t<0x01, uint16_t> in1;
+        cmd_in_t<0x02> in2;
+        cmd_in_t<0x03, uint8_t, uint8_t> in3;
+        cmd_out_t<0x40, uint8_t> out0;
+    };
+
+    template<> struct zcl_description_t<bench_cluster_t> {
+        static constexpr auto get()
+        {
+            using T = bench_cluster_t;
+            return cluster_t<
+                {.id = 0xfc10},
+                attributes_t<attribute_t{.m = &T::value, .id = 0x0000, .a = access_t::RP}>{},
+                commands_t<&T::in0, &T::in1, &T::in2, &T::in3, &T::out0>{}
+            >{};
+        }
+    };
+}
+
+namespace
+{
+    struct device_ctx_t
+    {
+        zb::bench_cluster_t bench;
+    };
+    device_ctx_t dev_ctx{};
+
+    auto zb_ctx = zb::make_device(
+            zb::make_ep_args<{.ep = 1, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 4}>(dev_ctx.bench)
+            );
+}
+
+struct zb::global_device
+{
+    static auto& get() { return zb_ctx; }
+};
+
+namespace
+{
+    void init_device()
+    {
+        zb_ctx.init();
+        zb_host::register_device(zb_ctx);
+        zb::zb_alarm_t::init();//this is the ZBOSS thread
+    }
+}
+
+ZB_BENCH(dispatch)
+{
+    init_device();
+
+    //the handler keeps the buffer (RET_BUSY) so the same one is dispatched over and over
+    static uint32_t g_Calls = 0;
+    dev_ctx.bench.in3.cb = [](uint8_t const&, uint8_t const&) -> zb::cmd_handling_result_t { ++g_Calls; return {RET_BUSY, true}; };
+    const uint8_t payload[] = {1, 2};
+    zb_bufid_t buf = zb_host::make_cmd_buf(1, 0xfc10, 0x03, payload, sizeof(payload));
+    ctx.run("on_cluster_cmd_handling (4 received cmds)", [&]{
+        zb_bool_t r = zb::on_cluster_cmd_handling<zb::bench_cluster_t, 1>(buf);
+        zb_bench::do_not_optimize(r);
+    });
+    auto *pHdr = ZB_BUF_GET_PARAM(buf, zb_zcl_parsed_hdr_t);
+    pHdr->cmd_id = 0x7f;//not handled: buffer stays with the caller
+    ctx.run("on_cluster_cmd_handling (unknown cmd)", [&]{
+        zb_bool_t r = zb::on_cluster_cmd_handling<zb::bench_cluster_t, 1>(buf);
+        zb_bench::do_not_optimize(r);
+    });
+    zb_buf_free(buf);
+
+    auto &ep = zb_ctx.ep<1>();
+    ctx.run("send_cmd_impl + APS confirm", [&]{
+        auto r = ep.send_cmd<&zb::bench_cluster_t::out0>(uint8_t(1));
+        zb_bench::do_not_optimize(r);
+        zb_host::confirm_all();
+        zb_host::sent().clear();
+    });
+
+    zb::zb_alarm_t a;
+    auto cb = [](void*){};
+    uint32_t ms = 1000;
+    ctx.run("zb_alarm_t::Setup (re-arm)", [&]{
+        zb_ret_t r = a.Setup(cb, nullptr, ms);
+        ms = ms % 100000 + 37;
+        zb_bench::do_not_optimize(r);
+    });
+    ctx.run("zb_alarm_t::Setup + Cancel", [&]{
+        zb_ret_t r = a.Setup(cb, nullptr, ms);
+        a.Cancel();
+        ms = ms % 100000 + 37;
+        zb_bench::do_not_optimize(r);
+    });
+}
@@ -0,0 +1,67 @@
+//zb_alarm_t request slots under contention: pop + push on one index_stack_t of kMaxForeignRequests slots
+//from 1, 2, 4 and 8 threads at once. Per pair: wall time over all threads, and the CAS retries
+#include "bench.hpp"
+#include "nrfzbcpp/zb_alarm.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct counting_stats_t
+    {
+        inline static thread_local uint64_t retries = 0;
+        static void cas_retry() { ++retries; }
+    };
+    using stack_t = zb::index_stack_t<zb::zb_alarm_t::kMaxForeignRequests, counting_stats_t>;
+
+    void bench_threads(zb_bench::ctx_t &ctx, size_t threads)
+    {
+        const size_t kPairs = ctx.quick ? 1000 : 1000000;//per thread
+        stack_t s{stack_t::full_t{}};
+        std::atomic<size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::atomic<uint64_t> retries{0};
+        std::vector<std::thread> workers;
+        for(size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&]{
+                ready.fetch_add(1);
+                while(!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                for(size_t i = 0; i < kPairs; ++i)
+                {
+                    if (auto slot = s.pop())
+                    {
+                        zb_bench::do_not_optimize(*slot);
+                        s.push(*slot);
+                    }
+                }
+                retries.fetch_add(counting_stats_t::retries);
+            });
+        }
+        while(ready.load() != threads)
+            std::this_thread::yield();
+
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = zb_bench::cycles();
+        go.store(true, std::memory_order_release);
+        for(auto &w : workers)
+            w.join();
+        uint64_t c1 = zb_bench::cycles();
+        auto t1 = std::chrono::steady_clock::now();
+
+        const double pairs = double(kPairs * threads);
+        char label[64];
+        snprintf(label, sizeof(label), "pop + push, %zu threads", threads);
+        printf("  %-56s %10.2f ns %12.1f cycles %10.2f retries/1k\n", label,
+                std::chrono::duration<double, std::nano>(t1 - t0).count() / pairs, double(c1 - c0) / pairs,
+                double(retries.load()) * 1000 / pairs);
+    }
+}
+
+ZB_BENCH(request_slots)
+{
+    for(size_t threads : {1, 2, 4, 8})
+        bench_threads(ctx, threads);
+}
@@ -0,0 +1,30 @@
+//NrfZBCpp_bench [--quick] [filter]
+//Runs every registered benchmark whose name contains 'filter'. Cycles are TSC ticks (x86) or the
+//virtual counter (aarch64), not core clocks: compare them between runs on the same machine only.
+#include "bench.hpp"
+#include <zb_host.hpp>
+#include <algorithm>
+
+int main(int argc, char **argv)
+{
+    zb_bench::ctx_t ctx;
+    for(int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--quick"))
+            ctx.quick = true;
+        else
+            ctx.filter = argv[i];
+    }
+
+    auto benches = zb_bench::bench_t::all();
+    std::sort(benches.begin(), benches.end(), [](auto const& a, auto const& b){ return strcmp(a.name, b.name) < 0; });
+    for(auto const& b : benches)
+    {
+        if (ctx.filter && !strstr(b.name, ctx.filter))
+            continue;
+        printf("%s\n", b.name);
+        zb_host::reset();
+        b.fn(ctx);
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+//Boot-time settings load (persistent_settings_manager_t::zigbee_settings_set): every key of 10 and 100 entries and an unknown one
+#include "bench.hpp"
+#include <zb_host.hpp>
+#include "nrfzbcpp/zb_settings.hpp"
+#include <utility>
+
+namespace
+{
+    //entry names must be constexpr char arrays: "zigbee/sNNN"
+    template<size_t I>
+    struct bench_setting_t
+    {
+        static constexpr char kName[] = {'z', 'i', 'g', 'b', 'e', 'e', '/', 's', char('0' + I / 100 % 10), char('0' + I / 10 % 10), char('0' + I % 10), 0};
+        inline static uint32_t value = 0;
+    };
+
+    template<class Seq> struct bench_settings_for;
+    template<size_t... I>
+    struct bench_settings_for<std::index_sequence<I...>>
+    {
+        using type = zb::persistent_settings_manager_t<7, zb::settings_entry_t{bench_setting_t<I>::kName, bench_setting_t<I>::value}...>;
+
+        //the lookup before the name table: a fold over every entry
+        static int fold_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+        {
+            int rc;
+            bool found = false;
+            auto process_entry = [&](auto e){
+                if (found) return;
+                const char *next;
+                if (settings_name_steq(name, e.name + 7, &next) && !next) {
+                    using T = std::remove_cvref_t<decltype(e.mem)>;
+                    found = true;
+                    if (len != sizeof(T)) {
+                        rc = -EINVAL;
+                        return;
+                    }
+                    rc = read_cb(cb_arg, &e.mem, sizeof(T));
+                    if (rc >= 0)
+                        rc = rc != sizeof(T) ? -EINVAL : 0;
+                }
+            };
+            (process_entry(zb::settings_entry_t{bench_setting_t<I>::kName, bench_setting_t<I>::value}),...);
+            return !found ? -ENOENT : rc;
+        }
+
+        static constexpr const char *kKeys[] = {(bench_setting_t<I>::kName + 7)..., "x"};
+    };
+
+    ssize_t read_value(void *cb_arg, void *data, size_t len)
+    {
+        std::memcpy(data, cb_arg, len);
+        return ssize_t(len);
+    }
+
+    template<size_t N>
+    void bench_load(zb_bench::ctx_t &ctx)
+    {
+        using settings_t = bench_settings_for<std::make_index_sequence<N>>;
+        static uint32_t stored = 0x12345678;
+        char what[32];
+        snprintf(what, sizeof(what), "%zu entries", N);
+        ctx.compare(what, settings_t::kKeys,
+                zb_bench::impl_t{"table", [](const char *k){ return settings_t::type::zigbee_settings_set(k, sizeof(uint32_t), read_value, &stored); }},
+                zb_bench::impl_t{"fold", [](const char *k){ return settings_t::fold_settings_set(k, sizeof(uint32_t), read_value, &stored); }});
+    }
+}
+
+ZB_BENCH(settings_load)
+{
+    bench_load<10>(ctx);
+    bench_load<100>(ctx);
+}
@@ -0,0 +1,13 @@
+#ifndef NRFZBCPP_HOST_LIB_FUNCTION_HPP_
+#define NRFZBCPP_HOST_LIB_FUNCTION_HPP_
+#include <cstddef>
+#include <functional>
+
+//host stand-in: the storage size limit isn't enforced
+template<size_t N, class Sig>
+struct FixedFunction: std::function<Sig>
+{
+    using std::function<Sig>::function;
+    using std::function<Sig>::operator=;
+};
+#endif
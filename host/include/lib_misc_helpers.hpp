@@ -0,0 +1,5 @@
+#ifndef NRFZBCPP_HOST_LIB_MISC_HELPERS_HPP_
+#define NRFZBCPP_HOST_LIB_MISC_HELPERS_HPP_
+
+#define FMT_PRINT(...) ((void)0)
+#endif
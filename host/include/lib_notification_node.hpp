@@ -0,0 +1,59 @@
+#ifndef NRFZBCPP_HOST_LIB_NOTIFICATION_NODE_HPP_
+#define NRFZBCPP_HOST_LIB_NOTIFICATION_NODE_HPP_
+
+//Intrusive list of all the live T objects, a node registers itself on construction
+template<class T>
+struct GenericNotificationNode
+{
+    struct list_t
+    {
+        struct iterator
+        {
+            GenericNotificationNode *p;
+            T* operator*() const { return static_cast<T*>(p); }
+            iterator& operator++() { p = p->m_pNextNode; return *this; }
+            bool operator!=(iterator const& rhs) const { return p != rhs.p; }
+        };
+        iterator begin() const { return {m_pHead}; }
+        iterator end() const { return {nullptr}; }
+
+        GenericNotificationNode *m_pHead = nullptr;
+    };
+    inline static list_t g_List;
+
+    GenericNotificationNode() { Register(); }
+    GenericNotificationNode(GenericNotificationNode const&) = delete;
+    GenericNotificationNode& operator=(GenericNotificationNode const&) = delete;
+    ~GenericNotificationNode() { Unregister(); }
+
+    bool Register()
+    {
+        if (m_Registered)
+            return false;
+        m_pNextNode = g_List.m_pHead;
+        g_List.m_pHead = this;
+        m_Registered = true;
+        return true;
+    }
+
+    bool Unregister()
+    {
+        if (!m_Registered)
+            return false;
+        for(auto **pp = &g_List.m_pHead; *pp; pp = &(*pp)->m_pNextNode)
+        {
+            if (*pp == this)
+            {
+                *pp = m_pNextNode;
+                break;
+            }
+        }
+        m_Registered = false;
+        return true;
+    }
+
+private:
+    GenericNotificationNode *m_pNextNode = nullptr;
+    bool m_Registered = false;
+};
+#endif
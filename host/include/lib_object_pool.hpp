@@ -0,0 +1,3 @@
+#ifndef NRFZBCPP_HOST_LIB_OBJECT_POOL_HPP_
+#define NRFZBCPP_HOST_LIB_OBJECT_POOL_HPP_
+#endif
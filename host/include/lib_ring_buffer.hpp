@@ -0,0 +1,3 @@
+#ifndef NRFZBCPP_HOST_LIB_RING_BUFFER_HPP_
+#define NRFZBCPP_HOST_LIB_RING_BUFFER_HPP_
+#endif
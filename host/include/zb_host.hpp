@@ -0,0 +1,132 @@
+#ifndef NRFZBCPP_HOST_ZB_HOST_HPP_
+#define NRFZBCPP_HOST_ZB_HOST_HPP_
+
+//Control surface of the host ZBOSS/Zephyr shim (host/zb_host_shim.cpp).
+//The shim is single "ZBOSS thread" by design: alarms, callbacks and work items run only when
+//the test/benchmark pumps them. zigbee_schedule_callback, ZB_TIMER_GET and k_current_get are thread-safe.
+
+#include <zboss_api.h>
+#include <zb_nrf_platform.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace zb_host
+{
+    //drops all queued alarms/callbacks/work, frees all buffers, clears logs and the settings store,
+    //rewinds the virtual clock to 'start' (beacon intervals)
+    void reset(zb_time_t start = 1000);
+
+    /**********************************************************************/
+    /* Virtual clock and the ZBOSS scheduler                              */
+    /**********************************************************************/
+    zb_time_t now();
+    //moves the clock forward by 'ticks', firing the due alarms in time order (and callbacks they schedule)
+    void advance(zb_time_t ticks);
+    inline void advance_ms(uint32_t ms) { advance(ZB_MILLISECONDS_TO_BEACON_INTERVAL(ms)); }
+    //jumps to the next alarm and fires it; false if none is armed
+    bool run_next_alarm();
+    size_t armed_alarms();
+    //the next 'n' zb_schedule_app_alarm calls fail with RET_NO_MEMORY (alarm pool full)
+    void fail_alarms(size_t n);
+    //runs queued zigbee_schedule_callback/zb_schedule_app_callback/delayed buffer callbacks until the queue is empty
+    size_t run_callbacks();
+    //the next 'n' zigbee_schedule_callback calls fail with RET_NO_MEMORY (scheduler queue full)
+    void fail_schedule_callbacks(size_t n);
+
+    //runs the items submitted to the "system work queue"
+    size_t run_work();
+    //the next 'n' k_work_submit calls fail with -EBUSY (queue draining)
+    void fail_work_submits(size_t n);
+
+    /**********************************************************************/
+    /* Buffers                                                            */
+    /**********************************************************************/
+    static constexpr size_t kMaxBufs = 128;//the cmd_bufs benchmark holds two pools of 64 at once
+    //amount of buffers zb_buf_get_out may hand out (<= kMaxBufs)
+    void set_buf_pool_size(size_t n);
+    size_t bufs_in_use();
+    //an incoming ZCL command buffer: payload in the buffer, the parsed header as the buffer parameter
+    zb_bufid_t make_cmd_buf(uint8_t dst_ep, uint16_t cluster, uint8_t cmd_id, const uint8_t *payload, size_t len, bool disable_default_response = true);
+
+    /**********************************************************************/
+    /* Sent ZCL packets                                                   */
+    /**********************************************************************/
+    struct sent_packet_t
+    {
+        zb_bufid_t buf;
+        uint16_t cluster;
+        uint8_t ep;
+        uint8_t dst_ep;
+        uint8_t addr_mode;
+        uint8_t frame_ctl;
+        std::vector<uint8_t> payload;//command id, then arguments
+        zb_callback_t cb;
+        bool confirmed;
+    };
+    std::vector<sent_packet_t>& sent();
+    //the next 'n' zb_zcl_finish_and_send_packet calls fail with RET_ERROR (the buffer stays with the caller)
+    void fail_sends(size_t n);
+    //delivers the APS confirmation of the i-th sent packet (frees the buffer if there's no callback), once
+    void confirm(size_t i, uint8_t status = RET_OK);
+    void confirm_all(uint8_t status = RET_OK);
+
+    /**********************************************************************/
+    /* Device, attributes, reporting, cluster handlers                    */
+    /**********************************************************************/
+    //what ZB_AF_REGISTER_DEVICE_CTX does: remembers the device and runs every cluster's init
+    void register_device(zb_af_device_ctx_t *pCtx);
+    zb_zcl_attr_t* find_attr(uint8_t ep, uint16_t cluster, uint8_t role, uint16_t attr);
+
+    struct attr_key_t
+    {
+        uint8_t ep;
+        uint16_t cluster;
+        uint16_t attr;
+        auto operator<=>(attr_key_t const&) const = default;
+    };
+    struct stats_t
+    {
+        size_t set_attr_calls = 0;
+        size_t marked_for_reporting = 0;
+        size_t settings_saves = 0;
+        size_t settings_deletes = 0;
+        size_t regulator_on = 0;
+    };
+    stats_t& stats();
+    //attributes marked for reporting, by zb_zcl_mark_attr_for_reporting or by a changing zb_zcl_set_attr_val
+    std::vector<attr_key_t>& reported();
+    //reporting configuration table (what zb_zcl_put_reporting_info installed)
+    std::map<attr_key_t, zb_zcl_reporting_info_t>& reporting_info();
+
+    //dispatches an incoming command to the handler registered by zb_zcl_add_cluster_handlers;
+    //returns what the handler returned (ZB_FALSE if there's none)
+    zb_bool_t deliver_cmd(zb_bufid_t buf, uint8_t role = ZB_ZCL_CLUSTER_SERVER_ROLE);
+    zb_zcl_cluster_check_value_t check_value_handler(uint16_t cluster, uint8_t role);
+
+    /**********************************************************************/
+    /* Settings                                                           */
+    /**********************************************************************/
+    using settings_set_t = int (*)(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg);
+    std::map<std::string, std::vector<uint8_t>>& settings_store();
+    //what settings_load_subtree does for a handler registered at 'subtree': every stored key under it
+    //is passed to 'set' with the subtree prefix (and '/') stripped
+    int settings_load_subtree(const char *subtree, settings_set_t set);
+    //called by settings_save_one before it stores anything (from whatever thread saves); a negative result fails the save
+    using settings_save_hook_t = int (*)(const char *name);
+    void set_settings_save_hook(settings_save_hook_t h);
+
+    /**********************************************************************/
+    /* ADC / regulator                                                    */
+    /**********************************************************************/
+    //every ADC sample reads this value; raw values are millivolts
+    void set_adc_raw(int32_t raw);
+    int regulators_enabled();
+}
+
+#define ZB_AF_REGISTER_DEVICE_CTX(pCtx) zb_host::register_device(pCtx)
+#endif
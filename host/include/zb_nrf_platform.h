@@ -0,0 +1,15 @@
+#ifndef NRFZBCPP_HOST_ZB_NRF_PLATFORM_H_
+#define NRFZBCPP_HOST_ZB_NRF_PLATFORM_H_
+#include "zboss_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//thread-safe: queues the callback for the ZBOSS thread (zb_host::run_callbacks)
+zb_ret_t zigbee_schedule_callback(zb_callback_t func, zb_uint8_t param);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,395 @@
+#ifndef NRFZBCPP_HOST_ZBOSS_API_H_
+#define NRFZBCPP_HOST_ZBOSS_API_H_
+
+//Host stand-in for the subset of the ZBOSS API used by the nrfzbcpp headers.
+//Types keep the ZBOSS names and layouts where the headers depend on them, numeric values of
+//signals and error codes only need to be distinct. Implemented by host/zb_host_shim.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t zb_uint8_t;
+typedef int8_t zb_int8_t;
+typedef uint16_t zb_uint16_t;
+typedef int16_t zb_int16_t;
+typedef uint32_t zb_uint32_t;
+typedef int32_t zb_int32_t;
+typedef uint64_t zb_uint64_t;
+typedef int64_t zb_int64_t;
+typedef unsigned zb_uint_t;
+typedef int zb_ret_t;
+typedef uint8_t zb_bufid_t;
+typedef uint32_t zb_time_t;
+typedef uint8_t zb_bool_t;
+typedef uint8_t zb_ieee_addr_t[8];
+typedef void (*zb_callback_t)(zb_uint8_t);
+typedef void (*zb_callback2_t)(zb_uint8_t, zb_uint16_t);
+
+#define ZB_TRUE 1
+#define ZB_FALSE 0
+
+#define RET_OK 0
+#define RET_ERROR -1
+#define RET_BUSY -2
+#define RET_NO_MEMORY -3
+#define RET_TIMEOUT -4
+#define RET_NOT_FOUND -5
+#define RET_ALREADY_EXISTS -6
+#define RET_ILLEGAL_REQUEST -7
+#define RET_NOT_IMPLEMENTED -8
+#define RET_INVALID_PARAMETER -9
+#define RET_CANCELLED -10
+#define RET_OUT_OF_RANGE -11
+
+#define ZB_PACKED_PRE
+#define ZB_PACKED_STRUCT __attribute__((packed))
+
+#define ZB_ASSERT(x) ((x) ? (void)0 : zb_host_assert_failed(__FILE__, __LINE__, #x))
+
+//ZBOSS time: beacon intervals of 15.36ms
+#define ZB_BEACON_INTERVAL_USEC 15360
+#define ZB_MILLISECONDS_TO_BEACON_INTERVAL(ms) ((zb_time_t)(((zb_uint64_t)(ms) * 1000 + ZB_BEACON_INTERVAL_USEC - 1) / ZB_BEACON_INTERVAL_USEC))
+#define ZB_TIME_BEACON_INTERVAL_TO_MSEC(t) ((zb_time_t)((zb_uint64_t)(t) * ZB_BEACON_INTERVAL_USEC / 1000))
+#define ZB_TIMER_GET() zb_timer_get()
+
+/* buffers */
+#define ZB_BUF_INVALID 0
+#define ZB_BUF_GET_PARAM(buf, T) ((T*)zb_buf_get_tail_func((buf), sizeof(T)))
+
+/* APS */
+#define ZB_AF_HA_PROFILE_ID 0x0104
+#define ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT 0
+#define ZB_APS_ADDR_MODE_16_GROUP_ENDP_NOT_PRESENT 1
+#define ZB_APS_ADDR_MODE_16_ENDP_PRESENT 2
+#define ZB_APS_ADDR_MODE_64_ENDP_PRESENT 3
+#define ZB_APS_ADDR_MODE_BIND_TBL_ID 4
+
+/* ZCL */
+#define ZB_ZCL_NULL_ID 0xffff
+#define ZB_ZCL_NON_MANUFACTURER_SPECIFIC 0xffff
+#define ZB_ZCL_MANUF_CODE_INVALID 0x0000
+#define ZB_ZCL_ATTR_GLOBAL_CLUSTER_REVISION_ID 0xfffd
+#define ZB_ZCL_FRAME_DIRECTION_TO_SRV 0
+#define ZB_ZCL_FRAME_DIRECTION_TO_CLI 1
+#define ZB_ZCL_CLUSTER_SERVER_ROLE 1
+#define ZB_ZCL_CLUSTER_CLIENT_ROLE 2
+#define ZB_ZCL_CONFIGURE_REPORTING_SEND_REPORT 0
+#define ZB_ZCL_GENERAL_GET_CMD_LISTS_PARAM 0xfe
+#define ZB_ZCL_SET_ATTR_VALUE_CB_ID 0
+#define ZB_ZCL_GET_SEQ_NUM() zb_host_zcl_next_seq_num()
+#define ZB_ZCL_PROCESS_COMMAND_FINISH(buf, hdr, status) zb_host_zcl_process_command_finish((buf), (hdr), (status))
+
+#define ZB_ZCL_STATUS_SUCCESS 0x00
+#define ZB_ZCL_STATUS_FAIL 0x01
+#define ZB_ZCL_STATUS_UNSUP_CMD 0x81
+#define ZB_ZCL_STATUS_INVALID_FIELD 0x85
+#define ZB_ZCL_STATUS_UNSUP_ATTRIB 0x86
+#define ZB_ZCL_STATUS_INVALID_VALUE 0x87
+#define ZB_ZCL_STATUS_READ_ONLY 0x88
+
+#define ZB_ZCL_CLUSTER_ID_BASIC 0x0000
+#define ZB_ZCL_CLUSTER_ID_POWER_CONFIG 0x0001
+#define ZB_ZCL_CLUSTER_ID_IDENTIFY 0x0003
+#define ZB_ZCL_CLUSTER_ID_GROUPS 0x0004
+#define ZB_ZCL_CLUSTER_ID_SCENES 0x0005
+#define ZB_ZCL_CLUSTER_ID_ON_OFF 0x0006
+#define ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL 0x0008
+#define ZB_ZCL_CLUSTER_ID_ALARMS 0x0009
+#define ZB_ZCL_CLUSTER_ID_POLL_CONTROL 0x0020
+
+//no stack-side cluster init on the host
+#define ZB_ZCL_CLUSTER_ID_POWER_CONFIG_SERVER_ROLE_INIT ((zb_zcl_cluster_init_t)0)
+#define ZB_ZCL_CLUSTER_ID_POWER_CONFIG_CLIENT_ROLE_INIT ((zb_zcl_cluster_init_t)0)
+#define ZB_ZCL_CLUSTER_ID_POLL_CONTROL_SERVER_ROLE_INIT ((zb_zcl_cluster_init_t)0)
+#define ZB_ZCL_CLUSTER_ID_POLL_CONTROL_CLIENT_ROLE_INIT ((zb_zcl_cluster_init_t)0)
+
+#define ZB_ZCL_ATTR_TYPE_NULL 0x00
+#define ZB_ZCL_ATTR_TYPE_8BIT 0x08
+#define ZB_ZCL_ATTR_TYPE_16BIT 0x09
+#define ZB_ZCL_ATTR_TYPE_24BIT 0x0a
+#define ZB_ZCL_ATTR_TYPE_32BIT 0x0b
+#define ZB_ZCL_ATTR_TYPE_40BIT 0x0c
+#define ZB_ZCL_ATTR_TYPE_48BIT 0x0d
+#define ZB_ZCL_ATTR_TYPE_56BIT 0x0e
+#define ZB_ZCL_ATTR_TYPE_64BIT 0x0f
+#define ZB_ZCL_ATTR_TYPE_BOOL 0x10
+#define ZB_ZCL_ATTR_TYPE_8BITMAP 0x18
+#define ZB_ZCL_ATTR_TYPE_16BITMAP 0x19
+#define ZB_ZCL_ATTR_TYPE_24BITMAP 0x1a
+#define ZB_ZCL_ATTR_TYPE_32BITMAP 0x1b
+#define ZB_ZCL_ATTR_TYPE_40BITMAP 0x1c
+#define ZB_ZCL_ATTR_TYPE_48BITMAP 0x1d
+#define ZB_ZCL_ATTR_TYPE_56BITMAP 0x1e
+#define ZB_ZCL_ATTR_TYPE_64BITMAP 0x1f
+#define ZB_ZCL_ATTR_TYPE_U8 0x20
+#define ZB_ZCL_ATTR_TYPE_U16 0x21
+#define ZB_ZCL_ATTR_TYPE_U24 0x22
+#define ZB_ZCL_ATTR_TYPE_U32 0x23
+#define ZB_ZCL_ATTR_TYPE_U40 0x24
+#define ZB_ZCL_ATTR_TYPE_U48 0x25
+#define ZB_ZCL_ATTR_TYPE_U56 0x26
+#define ZB_ZCL_ATTR_TYPE_U64 0x27
+#define ZB_ZCL_ATTR_TYPE_S8 0x28
+#define ZB_ZCL_ATTR_TYPE_S16 0x29
+#define ZB_ZCL_ATTR_TYPE_S24 0x2a
+#define ZB_ZCL_ATTR_TYPE_S32 0x2b
+#define ZB_ZCL_ATTR_TYPE_S40 0x2c
+#define ZB_ZCL_ATTR_TYPE_S48 0x2d
+#define ZB_ZCL_ATTR_TYPE_S56 0x2e
+#define ZB_ZCL_ATTR_TYPE_S64 0x2f
+#define ZB_ZCL_ATTR_TYPE_8BIT_ENUM 0x30
+#define ZB_ZCL_ATTR_TYPE_16BIT_ENUM 0x31
+#define ZB_ZCL_ATTR_TYPE_SEMI 0x38
+#define ZB_ZCL_ATTR_TYPE_SINGLE 0x39
+#define ZB_ZCL_ATTR_TYPE_DOUBLE 0x3a
+#define ZB_ZCL_ATTR_TYPE_OCTET_STRING 0x41
+#define ZB_ZCL_ATTR_TYPE_CHAR_STRING 0x42
+#define ZB_ZCL_ATTR_TYPE_LONG_OCTET_STRING 0x43
+#define ZB_ZCL_ATTR_TYPE_LONG_CHAR_STRING 0x44
+#define ZB_ZCL_ATTR_TYPE_ARRAY 0x48
+#define ZB_ZCL_ATTR_TYPE_CUSTOM_32ARRAY 0x4a
+#define ZB_ZCL_ATTR_TYPE_STRUCTURE 0x4c
+#define ZB_ZCL_ATTR_TYPE_SET 0x50
+#define ZB_ZCL_ATTR_TYPE_BAG 0x51
+#define ZB_ZCL_ATTR_TYPE_TIME_OF_DAY 0xe0
+#define ZB_ZCL_ATTR_TYPE_DATE 0xe1
+#define ZB_ZCL_ATTR_TYPE_UTC_TIME 0xe2
+#define ZB_ZCL_ATTR_TYPE_CLUSTER_ID 0xe8
+#define ZB_ZCL_ATTR_TYPE_ATTRIBUTE_ID 0xe9
+#define ZB_ZCL_ATTR_TYPE_BACNET_OID 0xea
+#define ZB_ZCL_ATTR_TYPE_IEEE_ADDR 0xf0
+#define ZB_ZCL_ATTR_TYPE_128_BIT_KEY 0xf1
+#define ZB_ZCL_ATTR_TYPE_INVALID 0xff
+
+#define ZB_ZCL_ATTR_ACCESS_READ_ONLY 0x01
+#define ZB_ZCL_ATTR_ACCESS_WRITE_ONLY 0x02
+#define ZB_ZCL_ATTR_ACCESS_REPORTING 0x04
+
+/* signals */
+#define ZB_ZDO_SIGNAL_DEFAULT_START 0
+#define ZB_ZDO_SIGNAL_SKIP_STARTUP 1
+#define ZB_ZDO_SIGNAL_DEVICE_ANNCE 2
+#define ZB_ZDO_SIGNAL_LEAVE 3
+#define ZB_ZDO_SIGNAL_ERROR 4
+#define ZB_BDB_SIGNAL_DEVICE_FIRST_START 5
+#define ZB_BDB_SIGNAL_DEVICE_REBOOT 6
+#define ZB_BDB_SIGNAL_STEERING 10
+#define ZB_BDB_SIGNAL_FORMATION 11
+#define ZB_BDB_SIGNAL_FINDING_AND_BINDING_TARGET_FINISHED 12
+#define ZB_BDB_SIGNAL_FINDING_AND_BINDING_INITIATOR_FINISHED 13
+#define ZB_BDB_SIGNAL_TC_REJOIN_DONE 14
+#define ZB_NWK_SIGNAL_DEVICE_ASSOCIATED 15
+#define ZB_ZDO_SIGNAL_LEAVE_INDICATION 16
+#define ZB_BDB_SIGNAL_WWAH_REJOIN_STARTED 17
+#define ZB_ZGP_SIGNAL_COMMISSIONING 18
+#define ZB_COMMON_SIGNAL_CAN_SLEEP 22
+#define ZB_ZDO_SIGNAL_PRODUCTION_CONFIG_READY 23
+#define ZB_NWK_SIGNAL_NO_ACTIVE_LINKS_LEFT 24
+#define ZB_SIGNAL_SUBGHZ_SUSPEND 25
+#define ZB_SIGNAL_SUBGHZ_RESUME 26
+#define ZB_ZDO_SIGNAL_DEVICE_AUTHORIZED 47
+#define ZB_ZDO_SIGNAL_DEVICE_UPDATE 48
+#define ZB_NWK_SIGNAL_PANID_CONFLICT_DETECTED 49
+#define ZB_NLME_STATUS_INDICATION 50
+#define ZB_TCSWAP_DB_BACKUP_REQUIRED_SIGNAL 51
+#define ZB_TC_SWAPPED_SIGNAL 52
+#define ZB_BDB_SIGNAL_STEERING_CANCELLED 55
+#define ZB_BDB_SIGNAL_FORMATION_CANCELLED 56
+#define ZB_SIGNAL_READY_TO_SHUT 57
+#define ZB_NWK_SIGNAL_PERMIT_JOIN_STATUS 58
+#define ZB_ZDO_SIGNAL_GET_PARAMS(hdr, T) ((T*)((hdr) + 1))
+
+typedef union { zb_uint16_t addr_short; zb_ieee_addr_t addr_long; } zb_addr_u;
+
+typedef struct { zb_uint16_t id; zb_uint8_t type; zb_uint8_t access; zb_uint16_t manuf_code; void *data_p; } zb_zcl_attr_t;
+typedef struct { zb_uint8_t received_cnt; zb_uint8_t *received; zb_uint8_t generated_cnt; zb_uint8_t *generated; } zb_discover_cmd_list_t;
+typedef zb_ret_t (*zb_zcl_cluster_check_value_t)(zb_uint16_t attr_id, zb_uint8_t endpoint, zb_uint8_t *value);
+typedef void (*zb_zcl_cluster_write_attr_hook_t)(zb_uint8_t endpoint, zb_uint16_t attr_id, zb_uint8_t *new_value, zb_uint16_t manuf_code);
+typedef zb_bool_t (*zb_zcl_cluster_handler_t)(zb_uint8_t param);
+typedef void (*zb_zcl_cluster_init_t)(void);
+typedef struct
+{
+    zb_uint16_t cluster_id;
+    zb_uint16_t attr_count;
+    zb_zcl_attr_t *attr_desc_list;
+    zb_uint8_t role_mask;
+    zb_uint16_t manuf_code;
+    zb_zcl_cluster_init_t cluster_init;
+} zb_zcl_cluster_desc_t;
+
+typedef struct
+{
+    zb_uint8_t endpoint;
+    zb_uint16_t app_profile_id;
+    zb_uint16_t app_device_id;
+    zb_uint32_t app_device_version:4;
+    zb_uint32_t reserved:4;
+    zb_uint8_t app_input_cluster_count;
+    zb_uint8_t app_output_cluster_count;
+    zb_uint16_t app_cluster_list[2];
+} zb_af_simple_desc_1_1_t;
+
+union zb_zcl_attr_var_u
+{
+    zb_uint8_t u8;
+    zb_int8_t s8;
+    zb_uint16_t u16;
+    zb_int16_t s16;
+    zb_uint32_t u32;
+    zb_int32_t s32;
+    zb_uint8_t data_buf[4];
+};
+
+typedef struct
+{
+    zb_uint8_t direction;
+    zb_uint8_t ep;
+    zb_uint16_t cluster_id;
+    zb_uint8_t cluster_role;
+    zb_uint16_t attr_id;
+    zb_uint8_t flags;
+    zb_time_t run_time;
+    union
+    {
+        struct
+        {
+            zb_uint16_t min_interval;
+            zb_uint16_t max_interval;
+            union zb_zcl_attr_var_u delta;
+            union zb_zcl_attr_var_u reported_value;
+            zb_uint16_t def_min_interval;
+            zb_uint16_t def_max_interval;
+        } send_info;
+        struct { zb_uint16_t timeout; } recv_info;
+    } u;
+    struct { zb_uint16_t short_addr; zb_uint8_t endpoint; zb_uint16_t profile_id; } dst;
+    zb_uint16_t manuf_code;
+} zb_zcl_reporting_info_t;
+
+typedef struct { zb_uint16_t cluster_id; zb_uint16_t attr_id; } zb_zcl_cvc_alarm_variables_t;
+typedef void (*zb_device_handler_t)(zb_uint8_t param);
+typedef struct
+{
+    zb_uint8_t ep_id;
+    zb_uint16_t profile_id;
+    zb_device_handler_t device_handler;
+    void *identify_handler;
+    zb_uint8_t reserved_size;
+    void *reserved_ptr;
+    zb_uint8_t cluster_count;
+    zb_zcl_cluster_desc_t *cluster_desc_list;
+    void *simple_desc;
+    zb_uint8_t rep_info_count;
+    zb_zcl_reporting_info_t *reporting_info;
+    zb_uint8_t cvc_alarm_count;
+    zb_zcl_cvc_alarm_variables_t *cvc_alarm_info;
+} zb_af_endpoint_desc_t;
+typedef struct { zb_uint8_t ep_count; zb_af_endpoint_desc_t **ep_desc_list; } zb_af_device_ctx_t;
+
+typedef struct { zb_uint8_t status; zb_uint8_t dst_ep; } zb_zcl_command_send_status_t;
+typedef struct
+{
+    struct { struct { zb_uint16_t source_short; zb_uint8_t src_endpoint; zb_uint8_t dst_endpoint; } common_data; } addr_data;
+    zb_uint16_t cluster_id;
+    zb_uint16_t profile_id;
+    zb_uint8_t cmd_id;
+    zb_uint8_t cmd_direction;
+    zb_uint8_t seq_number;
+    zb_uint8_t is_common_command;
+    zb_uint8_t disable_default_response;
+    zb_uint8_t is_manuf_specific;
+    zb_uint16_t manuf_specific;
+} zb_zcl_parsed_hdr_t;
+
+typedef struct
+{
+    zb_uint16_t cluster_id;
+    zb_uint16_t attr_id;
+    union
+    {
+        zb_uint8_t data8;
+        zb_uint16_t data16;
+        zb_uint8_t data24[3];
+        zb_uint32_t data32;
+        zb_uint8_t data48[6];
+        zb_ieee_addr_t data_ieee;
+        struct { zb_uint8_t size; zb_uint8_t *p_data; } data_variable;
+    } values;
+} zb_zcl_set_attr_value_param_t;
+
+typedef struct
+{
+    zb_uint8_t device_cb_id;
+    zb_uint8_t endpoint;
+    zb_uint8_t attr_type;
+    zb_ret_t status;
+    union { zb_zcl_set_attr_value_param_t set_attr_value_param; } cb_param;
+} zb_zcl_device_callback_param_t;
+
+typedef struct { zb_uint16_t short_addr; zb_uint8_t src_ep; } zb_zcl_addr_t;
+typedef void (*zb_zcl_no_reporting_cb_t)(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint16_t attr_id);
+typedef void (*zb_zcl_report_attr_cb_t)(zb_zcl_addr_t *addr, zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint16_t attr_id, zb_uint8_t attr_type, zb_uint8_t *value);
+
+typedef zb_uint32_t zb_zdo_app_signal_type_t;
+typedef struct { zb_zdo_app_signal_type_t sig_type; } zb_zdo_app_signal_hdr_t;
+typedef struct { zb_uint16_t device_short_addr; } zb_zdo_signal_device_annce_params_t;
+typedef struct { zb_uint8_t leave_type; } zb_zdo_signal_leave_params_t;
+typedef struct { zb_ieee_addr_t device_addr; } zb_nwk_signal_device_associated_params_t;
+typedef struct { zb_uint16_t short_addr; zb_uint8_t rejoin; } zb_zdo_signal_leave_indication_params_t;
+typedef struct { zb_uint32_t sleep_tmo; } zb_zdo_signal_can_sleep_params_t;
+typedef struct { zb_uint16_t short_addr; zb_uint8_t authorization_status; } zb_zdo_signal_device_authorized_params_t;
+typedef struct { zb_uint16_t short_addr; zb_uint8_t status; } zb_zdo_signal_device_update_params_t;
+typedef struct { zb_uint8_t status; zb_uint16_t network_addr; } zb_nwk_command_status_t;
+
+struct zb_host_zcl_ctx_t { zb_discover_cmd_list_t *zb_zcl_cluster_cmd_list; };
+#define ZCL_CTX() (*zb_host_zcl_ctx())
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* buffers */
+zb_bufid_t zb_buf_get_out(void);
+zb_bufid_t zb_buf_get_in(void);
+void zb_buf_free(zb_bufid_t buf);
+zb_ret_t zb_buf_get_out_delayed_ext(zb_callback2_t cb, zb_uint16_t arg, zb_uint16_t max_size);
+void zb_buf_reuse(zb_bufid_t buf);
+void* zb_buf_begin(zb_bufid_t buf);
+zb_uint_t zb_buf_len(zb_bufid_t buf);
+void* zb_buf_initial_alloc(zb_bufid_t buf, zb_uint_t size);
+void* zb_buf_get_tail_func(zb_bufid_t buf, zb_uint_t size);
+zb_ret_t zb_buf_get_status(zb_bufid_t buf);
+
+/* ZCL */
+zb_ret_t zb_zcl_set_attr_val(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t cluster_role, zb_uint16_t attr_id, zb_uint8_t *value, zb_bool_t check_access);
+zb_ret_t zb_zcl_mark_attr_for_reporting(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t cluster_role, zb_uint16_t attr_id);
+zb_ret_t zb_zcl_put_reporting_info(zb_zcl_reporting_info_t *rep_info, zb_bool_t override);
+zb_zcl_reporting_info_t* zb_zcl_find_reporting_info(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t cluster_role, zb_uint16_t attr_id);
+zb_ret_t zb_zcl_add_cluster_handlers(zb_uint16_t cluster_id, zb_uint8_t cluster_role, zb_zcl_cluster_check_value_t check_value, zb_zcl_cluster_write_attr_hook_t write_attr_hook, zb_zcl_cluster_handler_t cluster_handler);
+void* zb_zcl_start_command_header(zb_bufid_t buf, zb_uint8_t frame_ctl, zb_uint16_t manuf_code, zb_uint8_t cmd_id, zb_uint8_t *tsn);
+zb_ret_t zb_zcl_finish_and_send_packet(zb_bufid_t buf, void *end, zb_addr_u *dst_addr, zb_uint8_t dst_addr_mode, zb_uint8_t dst_ep, zb_uint8_t ep, zb_uint16_t prof_id, zb_uint16_t cluster_id, zb_callback_t cb);
+
+/* scheduler */
+zb_ret_t zb_schedule_app_alarm(zb_callback_t cb, zb_uint8_t param, zb_time_t timeout_bi);
+zb_ret_t zb_schedule_alarm_cancel(zb_callback_t cb, zb_uint8_t param, zb_uint8_t *p_param);
+zb_ret_t zb_schedule_app_callback(zb_callback_t cb, zb_uint8_t param);
+zb_time_t zb_timer_get(void);
+
+/* signals */
+zb_zdo_app_signal_type_t zb_get_app_signal(zb_bufid_t buf, zb_zdo_app_signal_hdr_t **pp_hdr);
+
+void zb_osif_abort(void);
+int printk(const char *fmt, ...);
+
+/* host shim internals used by the macros above */
+void zb_host_assert_failed(const char *file, int line, const char *expr);
+struct zb_host_zcl_ctx_t* zb_host_zcl_ctx(void);
+zb_uint8_t zb_host_zcl_next_seq_num(void);
+void zb_host_zcl_process_command_finish(zb_bufid_t buf, zb_zcl_parsed_hdr_t *hdr, zb_uint8_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
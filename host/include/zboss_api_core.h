@@ -0,0 +1,4 @@
+#ifndef NRFZBCPP_HOST_ZBOSS_API_CORE_H_
+#define NRFZBCPP_HOST_ZBOSS_API_CORE_H_
+#include "zboss_api.h"
+#endif
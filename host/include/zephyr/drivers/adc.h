@@ -0,0 +1,26 @@
+#ifndef NRFZBCPP_HOST_ZEPHYR_DRIVERS_ADC_H_
+#define NRFZBCPP_HOST_ZEPHYR_DRIVERS_ADC_H_
+#include <cstdint>
+#include <cstddef>
+
+struct device { const char *name; };
+struct adc_sequence_options { uint32_t interval_us; void *callback; void *user_data; uint16_t extra_samplings; };
+struct adc_sequence
+{
+    const struct adc_sequence_options *options;
+    uint32_t channels;
+    void *buffer;
+    size_t buffer_size;
+    uint8_t resolution;
+    uint8_t oversampling;
+    bool calibrate;
+};
+struct adc_dt_spec { const struct device *dev; uint8_t channel_id; };
+
+//every sample reads zb_host::g_AdcRaw, raw values are millivolts
+int adc_sequence_init_dt(const struct adc_dt_spec *spec, struct adc_sequence *seq);
+int adc_read_dt(const struct adc_dt_spec *spec, const struct adc_sequence *seq);
+int adc_raw_to_millivolts_dt(const struct adc_dt_spec *spec, int32_t *valp);
+bool adc_is_ready_dt(const struct adc_dt_spec *spec);
+int adc_channel_setup_dt(const struct adc_dt_spec *spec);
+#endif
@@ -0,0 +1,7 @@
+#ifndef NRFZBCPP_HOST_ZEPHYR_DRIVERS_REGULATOR_H_
+#define NRFZBCPP_HOST_ZEPHYR_DRIVERS_REGULATOR_H_
+
+struct device;
+int regulator_enable(const struct device *dev);
+int regulator_disable(const struct device *dev);
+#endif
@@ -0,0 +1,29 @@
+#ifndef NRFZBCPP_HOST_ZEPHYR_KERNEL_H_
+#define NRFZBCPP_HOST_ZEPHYR_KERNEL_H_
+#include <cstdint>
+
+//every host thread gets its own k_thread object
+struct k_thread { int id; };
+typedef k_thread* k_tid_t;
+k_tid_t k_current_get(void);
+
+struct k_work;
+typedef void (*k_work_handler_t)(struct k_work *work);
+//submitted items run from zb_host::run_work() (the "system work queue")
+struct k_work
+{
+    k_work_handler_t handler;
+    struct k_work *next;
+    bool pending;
+};
+void k_work_init(struct k_work *work, k_work_handler_t handler);
+int k_work_submit(struct k_work *work);
+struct k_work_sync {};
+//waits for the item if run_work() is running it on another thread; a queued item is run right away on the calling thread
+bool k_work_flush(struct k_work *work, struct k_work_sync *sync);
+
+//advances the virtual clock, doesn't run anything
+int32_t k_msleep(int32_t ms);
+
+extern "C" int printk(const char *fmt, ...);
+#endif
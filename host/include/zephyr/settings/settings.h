@@ -0,0 +1,12 @@
+#ifndef NRFZBCPP_HOST_ZEPHYR_SETTINGS_H_
+#define NRFZBCPP_HOST_ZEPHYR_SETTINGS_H_
+#include <cstddef>
+#include <cerrno>
+#include <sys/types.h>
+
+//in-memory settings store, see zb_host::settings_load_subtree
+typedef ssize_t (*settings_read_cb)(void *cb_arg, void *data, size_t len);
+int settings_save_one(const char *name, const void *value, size_t val_len);
+int settings_delete(const char *name);
+int settings_name_steq(const char *name, const char *key, const char **next);
+#endif
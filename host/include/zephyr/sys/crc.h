@@ -0,0 +1,7 @@
+#ifndef NRFZBCPP_HOST_ZEPHYR_SYS_CRC_H_
+#define NRFZBCPP_HOST_ZEPHYR_SYS_CRC_H_
+#include <cstdint>
+#include <cstddef>
+
+uint32_t crc32_ieee(const uint8_t *data, size_t len);
+#endif
@@ -0,0 +1,9 @@
+#ifndef NRFZBCPP_HOST_ZEPHYR_SYS_REBOOT_H_
+#define NRFZBCPP_HOST_ZEPHYR_SYS_REBOOT_H_
+
+#define SYS_REBOOT_WARM 0
+#define SYS_REBOOT_COLD 1
+
+//aborts the host process
+[[noreturn]] void sys_reboot(int type);
+#endif
@@ -0,0 +1,14 @@
+#ifndef NRFZBCPP_HOST_ZIGBEE_APP_UTILS_H_
+#define NRFZBCPP_HOST_ZIGBEE_APP_UTILS_H_
+#include "zboss_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+zb_ret_t zigbee_default_signal_handler(zb_bufid_t bufid);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,6 @@
+#ifndef NRFZBCPP_HOST_ZIGBEE_ERROR_HANDLER_H_
+#define NRFZBCPP_HOST_ZIGBEE_ERROR_HANDLER_H_
+#include "zboss_api.h"
+
+#define ZB_ERROR_CHECK(x) ZB_ASSERT((x) == RET_OK)
+#endif
@@ -0,0 +1,64 @@
+#ifndef NRFZBCPP_HOST_TEST_HPP_
+#define NRFZBCPP_HOST_TEST_HPP_
+
+//Minimal test harness for the host tests: one executable per tests/*.cpp, ZB_TEST registers a case,
+//ZB_CHECK fails the case (and the executable) without stopping the remaining checks.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <zb_host.hpp>
+
+namespace zb_test
+{
+    struct test_t
+    {
+        const char *name;
+        void (*fn)();
+
+        static std::vector<test_t>& all()
+        {
+            static std::vector<test_t> g_All;
+            return g_All;
+        }
+
+        struct registrar_t
+        {
+            registrar_t(const char *name, void (*fn)()) { all().push_back({name, fn}); }
+        };
+    };
+
+    inline int g_Failures = 0;
+
+    inline void check(bool ok, const char *expr, const char *file, int line)
+    {
+        if (ok)
+            return;
+        printf("  %s:%d: check failed: %s\n", file, line, expr);
+        ++g_Failures;
+    }
+}
+
+#define ZB_CHECK(expr) zb_test::check(bool(expr), #expr, __FILE__, __LINE__)
+
+#define ZB_TEST(name) \
+    static void name(); \
+    static zb_test::test_t::registrar_t g_##name##_registrar{#name, &name}; \
+    static void name()
+
+//tests run in the order they are defined; the shim is reset once, before the first one
+//(a device keeps its pre-allocated buffers, so tests sharing one must leave none of them in flight)
+#define ZB_TEST_MAIN() \
+    int main() \
+    { \
+        zb_host::reset(); \
+        for(auto const& t : zb_test::test_t::all()) \
+        { \
+            int failures = zb_test::g_Failures; \
+            t.fn(); \
+            printf("%s: %s\n", t.name, failures == zb_test::g_Failures ? "ok" : "FAILED"); \
+        } \
+        return zb_test::g_Failures ? EXIT_FAILURE : EXIT_SUCCESS; \
+    }
+
+#endif
@@ -0,0 +1,141 @@
+//zb_alarm_t Setup/Cancel from foreign threads: request slots, the wake-up of the ZBOSS thread, boot-time init()
+//The main thread is the ZBOSS thread. Also meant to be run under ThreadSanitizer (NRFZBCPP_HOST_SANITIZE=thread)
+#include "test.hpp"
+#include "nrfzbcpp/zb_alarm.hpp"
+#include <array>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<uint32_t> g_Fired{0};
+    void on_alarm(void*) { g_Fired.fetch_add(1, std::memory_order_relaxed); }
+
+    //runs 'f' on a new thread and waits for it
+    template<class F>
+    void on_foreign_thread(F &&f)
+    {
+        std::thread t(std::forward<F>(f));
+        t.join();
+    }
+}
+
+//before the fix only the first pending request woke the ZBOSS thread: a failed wake-up stranded everything after it
+ZB_TEST(failed_wakeup_is_retried_by_the_next_request)
+{
+    zb::zb_alarm_t::init();
+    static zb::zb_alarm_t a, b;
+    zb_host::fail_schedule_callbacks(1);
+    on_foreign_thread([]{ ZB_CHECK(a.Setup(on_alarm, nullptr, 100) != RET_OK); });
+    ZB_CHECK(zb_host::run_callbacks() == 0);
+    ZB_CHECK(!a.IsRunning());//queued, but nobody woke the ZBOSS thread up
+    on_foreign_thread([]{ ZB_CHECK(b.Setup(on_alarm, nullptr, 100) == RET_OK); });
+    ZB_CHECK(zb_host::run_callbacks() == 1);
+    ZB_CHECK(a.IsRunning() && b.IsRunning());
+    ZB_CHECK(zb::zb_alarm_t::g_PendingRequests.empty());
+    uint32_t fired = g_Fired.load();
+    zb_host::advance_ms(200);
+    ZB_CHECK(g_Fired.load() == fired + 2);
+}
+
+//Setup reports a ZBOSS alarm that can't be scheduled instead of leaving the alarm armed with nothing to fire it
+ZB_TEST(failed_wheel_alarm_fails_setup)
+{
+    zb::zb_alarm_t::init();
+    static zb::zb_alarm_t a;
+    zb_host::advance_ms(1000);//nothing armed: the wheel alarm has to be scheduled
+    zb_host::fail_alarms(1);
+    ZB_CHECK(a.Setup(on_alarm, nullptr, 100) != RET_OK);
+    ZB_CHECK(!a.IsRunning());
+    ZB_CHECK(a.Setup(on_alarm, nullptr, 100) == RET_OK);
+    uint32_t fired = g_Fired.load();
+    zb_host::advance_ms(200);
+    ZB_CHECK(g_Fired.load() == fired + 1);
+}
+
+//more alarms than request slots armed during boot: with init() they don't go through the slots at all
+ZB_TEST(boot_time_setup_after_init)
+{
+    zb::zb_alarm_t::init();
+    static std::array<zb::zb_alarm_t, zb::zb_alarm_t::kMaxForeignRequests * 2> alarms;
+    for(auto &a : alarms)
+        ZB_CHECK(a.Setup(on_alarm, nullptr, 50) == RET_OK);
+    for(auto &a : alarms)
+        ZB_CHECK(a.IsRunning());
+    ZB_CHECK(zb::zb_alarm_t::g_PendingRequests.empty());
+    uint32_t fired = g_Fired.load();
+    zb_host::advance_ms(100);
+    ZB_CHECK(g_Fired.load() == fired + alarms.size());
+}
+
+//several threads hammer Setup/Cancel while the ZBOSS thread pumps callbacks and alarms, with wake-ups failing now and then.
+//Every thread ends with one more Setup per alarm, retried until it's RET_OK: that one decides the final state
+//(Cancel reports nothing, so a short Setup that fires right away stands in for the disarmed state)
+ZB_TEST(foreign_threads_stress)
+{
+    zb::zb_alarm_t::init();
+    constexpr size_t kThreads = 4;
+    constexpr size_t kAlarmsPerThread = 4;
+    constexpr size_t kOpsPerThread = 5000;
+    constexpr uint32_t kLongMs = 7 * 24 * 3600 * 1000;//the virtual clock runs fast while the threads are busy
+    static std::array<std::array<zb::zb_alarm_t, kAlarmsPerThread>, kThreads> alarms;
+    std::array<std::array<bool, kAlarmsPerThread>, kThreads> finalArmed{};
+    std::atomic<size_t> running{kThreads};
+
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&, t]{
+            std::mt19937 rng(uint32_t(t + 1));
+            auto op = [&](zb::zb_alarm_t &a, bool arm) -> zb_ret_t {
+                if (!arm)
+                {
+                    a.Cancel();
+                    return RET_OK;
+                }
+                return a.Setup(on_alarm, nullptr, 1 + rng() % 50);
+            };
+            for(size_t i = 0; i < kOpsPerThread; ++i)
+            {
+                if (op(alarms[t][rng() % kAlarmsPerThread], rng() % 3 != 0) != RET_OK)
+                    std::this_thread::yield();
+            }
+            for(size_t i = 0; i < kAlarmsPerThread; ++i)
+            {
+                bool arm = rng() % 2;
+                //long enough not to fire while the other threads are still going
+                while(alarms[t][i].Setup(on_alarm, nullptr, arm ? kLongMs : 1) != RET_OK)
+                    std::this_thread::yield();
+                finalArmed[t][i] = arm;
+            }
+            running.fetch_sub(1);
+        });
+    }
+
+    std::mt19937 rng(100);
+    while(running.load())
+    {
+        if (rng() % 8 == 0)
+            zb_host::fail_schedule_callbacks(1);
+        zb_host::run_callbacks();
+        zb_host::advance(rng() % 3);
+    }
+    for(auto &th : threads)
+        th.join();
+    zb_host::fail_schedule_callbacks(0);
+    zb_host::run_callbacks();
+    zb_host::advance_ms(1000);
+
+    ZB_CHECK(zb::zb_alarm_t::g_PendingRequests.empty());
+    for(size_t t = 0; t < kThreads; ++t)
+        for(size_t i = 0; i < kAlarmsPerThread; ++i)
+            ZB_CHECK(alarms[t][i].IsRunning() == finalArmed[t][i]);
+    zb_host::advance_ms(kLongMs + 1000);
+    for(auto &row : alarms)
+        for(auto &a : row)
+            ZB_CHECK(!a.IsRunning());
+}
+
+ZB_TEST_MAIN()
@@ -0,0 +1,241 @@
+//battery_measurements_block_t with async = true: regulator, settle alarm, work queue read, update on the ZBOSS thread;
+//battery alarms: thresholds, hysteresis, batt_alarm_state and the Alarm frames; the discharge curves
+#include <cstring>
+#include "test.hpp"
+#include "nrfzbcpp/zb_main.hpp"
+#include "nrfzbcpp/zb_power_config_cluster_desc.hpp"
+#include "nrfzbcpp/zb_power_config_tools.hpp"
+#include <bit>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct device_ctx_t
+    {
+        zb::zb_zcl_power_cfg_battery_settings_t batt;
+    };
+    device_ctx_t dev_ctx{};
+
+    auto zb_ctx = zb::make_device(zb::make_ep_args<{.ep = 1, .dev_id = 0x0007, .dev_ver = 1}>(dev_ctx.batt));
+
+    device g_RegDev{"reg"};
+    adc_dt_spec g_Channels[1] = {{&g_RegDev, 0}};
+    auto g_Batt = zb::make_battery_measurements_block<{.maxBatteryVoltage = 3000, .minBatteryVoltage = 2000, .async = true, .settle_ms = 20}>(
+            zb_ctx.ep<1>(), g_Channels, &g_RegDev);
+
+    void init_device()
+    {
+        static bool g_Init = false;
+        if (!std::exchange(g_Init, true))
+        {
+            zb::zb_alarm_t::init();
+            zb_ctx.init();
+            zb_host::register_device(zb_ctx);
+            ZB_CHECK(g_Batt.setup() == 0);
+        }
+    }
+}
+
+ZB_TEST(async_measurement)
+{
+    init_device();
+    zb_host::set_adc_raw(2800);
+    g_Batt.update();
+    ZB_CHECK(zb_host::regulators_enabled() == 1);
+    g_Batt.update();//in progress: ignored
+    ZB_CHECK(zb_host::regulators_enabled() == 1);
+    ZB_CHECK(zb_host::run_work() == 0);//still settling
+    zb_host::advance_ms(30);
+    ZB_CHECK(zb_host::run_work() == 1);
+    ZB_CHECK(zb_host::regulators_enabled() == 0);
+    ZB_CHECK(zb_host::run_callbacks() == 1);
+    ZB_CHECK(dev_ctx.batt.batt_voltage == 28);
+    //done: the next update() starts a new measurement
+    g_Batt.update();
+    ZB_CHECK(zb_host::regulators_enabled() == 1);
+    zb_host::advance_ms(30);
+    zb_host::run_work();
+    zb_host::run_callbacks();
+    ZB_CHECK(zb_host::regulators_enabled() == 0);
+}
+
+//a settle alarm that can't be armed must not leave the regulator on and the block busy forever
+ZB_TEST(failed_settle_alarm_releases_regulator)
+{
+    init_device();
+    //Setup from a foreign thread fails when the ZBOSS thread can't be woken up
+    zb_host::fail_schedule_callbacks(1);
+    std::thread([]{ g_Batt.update(); }).join();
+    ZB_CHECK(zb_host::regulators_enabled() == 0);
+    //the queued Setup and Cancel reach the ZBOSS thread with the next wake-up: nothing is measured
+    zb_host::run_callbacks();
+    zb_host::advance_ms(30);
+    ZB_CHECK(zb_host::run_work() == 0);
+    //not busy anymore
+    g_Batt.update();
+    ZB_CHECK(zb_host::regulators_enabled() == 1);
+    zb_host::advance_ms(30);
+    ZB_CHECK(zb_host::run_work() == 1);
+    ZB_CHECK(zb_host::run_callbacks() == 1);
+    ZB_CHECK(zb_host::regulators_enabled() == 0);
+}
+
+//a work item that can't be submitted must not leave the regulator on and the block busy forever
+ZB_TEST(failed_work_submit_releases_regulator)
+{
+    init_device();
+    g_Batt.update();
+    ZB_CHECK(zb_host::regulators_enabled() == 1);
+    zb_host::fail_work_submits(1);
+    zb_host::advance_ms(30);
+    ZB_CHECK(zb_host::regulators_enabled() == 0);
+    ZB_CHECK(zb_host::run_work() == 0);
+    //not busy anymore
+    g_Batt.update();
+    ZB_CHECK(zb_host::regulators_enabled() == 1);
+    zb_host::advance_ms(30);
+    ZB_CHECK(zb_host::run_work() == 1);
+    ZB_CHECK(zb_host::run_callbacks() == 1);
+    ZB_CHECK(zb_host::regulators_enabled() == 0);
+}
+
+namespace
+{
+    using batt_t = decltype(g_Batt);
+    static_assert(batt_t::kHasAlarms);
+
+    uint32_t alarm_state() { return std::bit_cast<uint32_t>(dev_ctx.batt.batt_alarm_state); }
+
+    //applies a measurement (linear: 2000-3000mV -> 0-100%), true if batt_alarm_state was written
+    bool apply(int32_t mv)
+    {
+        size_t calls = zb_host::stats().set_attr_calls;
+        g_Batt.apply(mv);
+        zb_host::run_callbacks();//the Alarm frames go out from delayed buffer callbacks
+        return zb_host::stats().set_attr_calls - calls > 2;//batt_voltage and batt_percentage_remaining are always written
+    }
+
+    //voltage thresholds: min 2.2V, threshold1 2.5V; percentage ones unused. Only the min threshold alarm is enabled
+    void reset_alarms()
+    {
+        auto &b = dev_ctx.batt;
+        b.batt_voltage_min_threshold = 22;
+        b.batt_voltage_threshold1 = 25;
+        b.batt_voltage_threshold2 = 0;
+        b.batt_voltage_threshold3 = 0xff;
+        b.batt_percentage_min_threshold = b.batt_percentage_threshold1 = b.batt_percentage_threshold2 = b.batt_percentage_threshold3 = 0;
+        b.batt_alarm_mask = {.low = 1};
+        apply(3000);
+        zb_host::sent().clear();
+    }
+}
+
+ZB_TEST(alarm_raised_at_threshold_and_cleared_above_hysteresis)
+{
+    init_device();
+    reset_alarms();
+    ZB_CHECK(alarm_state() == 0);
+    ZB_CHECK(!apply(2600));
+    ZB_CHECK(apply(2500));//at threshold1
+    ZB_CHECK(alarm_state() == 0b0010);
+    ZB_CHECK(!apply(2600));//25 + hysteresis 1: still inside the band
+    ZB_CHECK(alarm_state() == 0b0010);
+    ZB_CHECK(apply(2700));
+    ZB_CHECK(alarm_state() == 0);
+    ZB_CHECK(zb_host::sent().empty());//threshold1 isn't in batt_alarm_mask
+}
+
+//batt_alarm_mask filters the frames, not batt_alarm_state; an alarm that stays raised isn't sent again
+ZB_TEST(alarm_frame_for_masked_alarms_only)
+{
+    init_device();
+    reset_alarms();
+    ZB_CHECK(apply(2200));
+    ZB_CHECK(alarm_state() == 0b0011);
+    ZB_CHECK(zb_host::sent().size() == 1);
+    auto const& f = zb_host::sent()[0];
+    ZB_CHECK(f.cluster == ZB_ZCL_CLUSTER_ID_ALARMS && f.ep == 1);
+    //Alarm: command 0x00, alarm code 0x10 (BatteryVoltageMinThreshold of source 1), cluster id 0x0001
+    ZB_CHECK((f.payload == std::vector<uint8_t>{0x00, 0x10, 0x01, 0x00}));
+    ZB_CHECK(!apply(2100));
+    ZB_CHECK(zb_host::sent().size() == 1);
+    ZB_CHECK(apply(2400));//min threshold cleared, threshold1 still raised
+    ZB_CHECK(alarm_state() == 0b0010);
+    ZB_CHECK(apply(2200));//raised again: sent again
+    ZB_CHECK(zb_host::sent().size() == 2);
+}
+
+//percentage thresholds are in 1%, batt_percentage_remaining and the hysteresis band in 0.5%
+ZB_TEST(percentage_alarm)
+{
+    init_device();
+    reset_alarms();
+    dev_ctx.batt.batt_voltage_min_threshold = dev_ctx.batt.batt_voltage_threshold1 = 0;
+    dev_ctx.batt.batt_percentage_threshold2 = 30;
+    ZB_CHECK(!apply(2310));//31%
+    ZB_CHECK(apply(2300));//30%
+    ZB_CHECK(alarm_state() == 0b0100);
+    ZB_CHECK(!apply(2320));//32%: 30 + hysteresis 2
+    ZB_CHECK(apply(2330));
+    ZB_CHECK(alarm_state() == 0);
+}
+
+namespace
+{
+    //voltage_to_percentage: the discharge curve presets as Q16 segments, multi-cell, clamping
+    template<zb::battery_cfg_t cfg>
+    constexpr uint8_t pct(int32_t mv) { return zb::battery_measurements_block_t<cfg, std::remove_reference_t<decltype(zb_ctx.ep<1>())>>::voltage_to_percentage(mv); }
+
+    constexpr zb::battery_cfg_t kAlkaline{.curve = zb::battery_curves::kAlkaline};
+    constexpr zb::battery_cfg_t kLiSOCl2{.curve = zb::battery_curves::kLiSOCl2};
+    constexpr zb::battery_cfg_t kNiMH{.curve = zb::battery_curves::kNiMH};
+    constexpr zb::battery_cfg_t kAlkaline2{.curve = zb::battery_curves::kAlkaline, .cells = 2};
+    constexpr zb::battery_cfg_t kLinear{.maxBatteryVoltage = 3000, .minBatteryVoltage = 2000};
+
+    //preset endpoints (batt_percentage_remaining is in 0.5%)
+    static_assert(pct<kAlkaline>(900) == 0 && pct<kAlkaline>(1580) == 200);
+    static_assert(pct<kLiSOCl2>(2800) == 0 && pct<kLiSOCl2>(3650) == 200);
+    static_assert(pct<kNiMH>(950) == 0 && pct<kNiMH>(1400) == 200);
+    //clamped below and above the curve
+    static_assert(pct<kAlkaline>(0) == 0 && pct<kAlkaline>(899) == 0);
+    static_assert(pct<kAlkaline>(1581) == 200 && pct<kAlkaline>(5000) == 200);
+    //midpoint of a steep segment (3450mV 40% - 3500mV 60%) and of a flat one (2800mV 0% - 3000mV 1%)
+    static_assert(pct<kLiSOCl2>(3475) == 100);
+    static_assert(pct<kLiSOCl2>(2900) == 1);
+    //cells multiply the curve voltages: 1230mV 30% - 1290mV 45% per cell
+    static_assert(pct<kAlkaline2>(2460) == 60 && pct<kAlkaline2>(2520) == 75);
+    static_assert(pct<kAlkaline2>(1800) == 0 && pct<kAlkaline2>(3160) == 200);
+    static_assert(pct<kAlkaline2>(1580) == 0);//a full single cell is an empty pair
+    //no curve: linear between minBatteryVoltage and maxBatteryVoltage
+    static_assert(pct<kLinear>(1999) == 0 && pct<kLinear>(2500) == 100 && pct<kLinear>(3001) == 200);
+
+    template<zb::battery_cfg_t cfg>
+    bool non_decreasing()
+    {
+        uint8_t prev = 0;
+        for(int32_t mv = 0; mv <= 8000; ++mv)
+        {
+            uint8_t p = pct<cfg>(mv);
+            if (p < prev || p > 200)
+            {
+                printf("  %d mV: %u after %u\n", mv, p, prev);
+                return false;
+            }
+            prev = p;
+        }
+        return prev == 200;
+    }
+}
+
+//no dips at the segment joints from the Q16 rounding
+ZB_TEST(curves_non_decreasing)
+{
+    ZB_CHECK(non_decreasing<kAlkaline>());
+    ZB_CHECK(non_decreasing<kLiSOCl2>());
+    ZB_CHECK(non_decreasing<kNiMH>());
+    ZB_CHECK(non_decreasing<kAlkaline2>());
+    ZB_CHECK(non_decreasing<kLinear>());
+}
+
+ZB_TEST_MAIN()
@@ -0,0 +1,260 @@
+//Deferred outgoing commands (pending_queue_depth): order, failures and callbacks that send again;
+//the auto-sized command queue (cmd_queue_depth = 0); allocation failures reported by device init
+#include <cstring>
+#include "test.hpp"
+#include "nrfzbcpp/zb_main.hpp"
+
+namespace zb
+{
+    struct queue_cluster_t
+    {
+        uint8_t value;
+        cmd_out_t<0x40, uint8_t> out0;
+    };
+
+    template<> struct zcl_description_t<queue_cluster_t> {
+        static constexpr auto get()
+        {
+            using T = queue_cluster_t;
+            return cluster_t<
+                {.id = 0xfc40},
+                attributes_t<attribute_t{.m = &T::value, .id = 0x0000, .a = access_t::Read}>{},
+                commands_t<&T::out0>{}
+            >{};
+        }
+    };
+}
+
+//cmd_queue_depth = 0: the queue is sized from the generated commands
+namespace zb
+{
+    struct no_cmds_cluster_t
+    {
+        uint8_t value;
+    };
+
+    //1 + 2 (with a timeout) + 1
+    struct some_cmds_cluster_t
+    {
+        uint8_t value;
+        cmd_out_t<0x41> out1;
+        cmd_generic_t<{.cmd_id = 0x42, .timeout_ms = 1000}> out2;
+        cmd_out_t<0x43, uint16_t> out3;
+    };
+
+    //5 x 2: above the cap
+    struct many_cmds_cluster_t
+    {
+        uint8_t value;
+        cmd_generic_t<{.cmd_id = 0x50, .timeout_ms = 1000}> out0;
+        cmd_generic_t<{.cmd_id = 0x51, .timeout_ms = 1000}> out1;
+        cmd_generic_t<{.cmd_id = 0x52, .timeout_ms = 1000}> out2;
+        cmd_generic_t<{.cmd_id = 0x53, .timeout_ms = 1000}> out3;
+        cmd_generic_t<{.cmd_id = 0x54, .timeout_ms = 1000}> out4;
+    };
+
+    template<> struct zcl_description_t<no_cmds_cluster_t> {
+        static constexpr auto get()
+        {
+            using T = no_cmds_cluster_t;
+            return cluster_t<
+                {.id = 0xfc41},
+                attributes_t<attribute_t{.m = &T::value, .id = 0x0000, .a = access_t::Read}>{}
+            >{};
+        }
+    };
+
+    template<> struct zcl_description_t<some_cmds_cluster_t> {
+        static constexpr auto get()
+        {
+            using T = some_cmds_cluster_t;
+            return cluster_t<
+                {.id = 0xfc42},
+                attributes_t<attribute_t{.m = &T::value, .id = 0x0000, .a = access_t::Read}>{},
+                commands_t<&T::out1, &T::out2, &T::out3>{}
+            >{};
+        }
+    };
+
+    template<> struct zcl_description_t<many_cmds_cluster_t> {
+        static constexpr auto get()
+        {
+            using T = many_cmds_cluster_t;
+            return cluster_t<
+                {.id = 0xfc43},
+                attributes_t<attribute_t{.m = &T::value, .id = 0x0000, .a = access_t::Read}>{},
+                commands_t<&T::out0, &T::out1, &T::out2, &T::out3, &T::out4>{}
+            >{};
+        }
+    };
+}
+
+namespace
+{
+    struct auto_ctx_t
+    {
+        zb::no_cmds_cluster_t none;
+        zb::some_cmds_cluster_t some;
+        zb::many_cmds_cluster_t many;
+    };
+    auto_ctx_t auto_ctx{};
+
+    auto zb_auto_ctx = zb::make_device(
+            zb::make_ep_args<{.ep = 1, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 0}>(auto_ctx.none),
+            zb::make_ep_args<{.ep = 2, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 0}>(auto_ctx.some),
+            zb::make_ep_args<{.ep = 3, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 0}>(auto_ctx.many)
+            );
+    template<uint8_t ep>
+    using auto_ep_t = std::remove_reference_t<decltype(zb_auto_ctx.ep<ep>())>;
+
+    static_assert(auto_ep_t<1>::kCmdQueueSize == 0);
+    static_assert(auto_ep_t<2>::kCmdQueueSize == 4);
+    static_assert(auto_ep_t<3>::kCmdQueueSize == auto_ep_t<3>::kMaxAutoCmdQueueSize);
+}
+
+//an EP without command buffers still builds and initializes: its pool is empty
+ZB_TEST(auto_sized_cmd_queue)
+{
+    zb_auto_ctx.init();
+    ZB_CHECK(zb_auto_ctx.ep<1>().available_cmd_bufs() == 0);
+    ZB_CHECK(zb_auto_ctx.ep<2>().available_cmd_bufs() == 4);
+    ZB_CHECK(zb_auto_ctx.ep<3>().available_cmd_bufs() == 8);
+    zb::pre_alloc_zb_bufs_out<0> none;
+    ZB_CHECK(none.init() == 0);
+    ZB_CHECK(none.available() == 0 && none.allocate() == ZB_BUF_INVALID);
+    none.free();
+    zb::pre_alloc_zb_bufs_out<auto_ep_t<2>::kCmdQueueSize> some;
+    ZB_CHECK(some.init() == 0 && some.available() == 4);
+    some.free();
+}
+
+namespace
+{
+    struct pool_ctx_t
+    {
+        zb::queue_cluster_t shared1;
+        zb::queue_cluster_t shared2;
+        zb::queue_cluster_t own;
+    };
+    pool_ctx_t pool_ctx{};
+
+    //a shared pool of 3 buffers (reserved 1 + 1, plus 1 more for either EP) and 2 buffers of EP 3
+    auto zb_pool_ctx = zb::make_device(
+            zb::make_ep_args<{.ep = 1, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 2, .shared_cmd_bufs = true, .cmd_bufs_reserved = 1}>(pool_ctx.shared1),
+            zb::make_ep_args<{.ep = 2, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 2, .shared_cmd_bufs = true, .cmd_bufs_reserved = 1}>(pool_ctx.shared2),
+            zb::make_ep_args<{.ep = 3, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 2}>(pool_ctx.own)
+            );
+    static_assert(decltype(zb_pool_ctx)::kSharedCmdBufsSize == 3);
+}
+
+//device init used to drop the allocation failures of the shared pool
+ZB_TEST(init_reports_failed_cmd_bufs)
+{
+    zb_host::set_buf_pool_size(zb_host::bufs_in_use() + 2);
+    ZB_CHECK(zb_pool_ctx.init() == 3);//1 of the shared pool, 2 of EP 3
+    ZB_CHECK(zb_pool_ctx.shared_cmd_bufs_available() == 2);
+    ZB_CHECK(zb_pool_ctx.ep<3>().available_cmd_bufs() == 0);
+    zb_host::set_buf_pool_size(zb_host::kMaxBufs);
+}
+
+namespace
+{
+    struct device_ctx_t
+    {
+        zb::queue_cluster_t c;
+    };
+    device_ctx_t dev_ctx{};
+
+    auto zb_ctx = zb::make_device(
+            zb::make_ep_args<{.ep = 1, .dev_id = 0x0007, .dev_ver = 1, .cmd_queue_depth = 1, .pending_queue_depth = 4}>(dev_ctx.c)
+            );
+    auto &ep = zb_ctx.ep<1>();
+
+    using task_t = zb::basic_task_t<512, 8>;
+
+    struct status_t
+    {
+        uint8_t arg;
+        zb_ret_t status;
+    };
+    std::vector<status_t> g_Statuses;
+    bool g_ResendOnFailure = false;
+
+    //send_cmd_async: with gcc 12 a status callback can't be passed in send_cmd_config_t (see README, Known issues)
+    task_t send(uint8_t arg)
+    {
+        zb_ret_t r = co_await ep.send_cmd_async<&zb::queue_cluster_t::out0, 0>(arg);
+        g_Statuses.push_back({arg, r});
+        if (r != RET_OK && std::exchange(g_ResendOnFailure, false))
+            ZB_CHECK(send(0xdd).started());
+    }
+
+    void init_device()
+    {
+        static bool g_Init = false;
+        if (!std::exchange(g_Init, true))
+        {
+            zb_ctx.init();
+            zb_host::register_device(zb_ctx);
+        }
+        zb_host::sent().clear();
+        g_Statuses.clear();
+        g_ResendOnFailure = false;
+    }
+
+    uint8_t sent_arg(size_t i) { return zb_host::sent()[i].payload.at(1); }
+}
+
+ZB_TEST(deferred_cmds_keep_order)
+{
+    init_device();
+    send(0xa0);
+    send(0xb0);
+    send(0xc0);
+    ZB_CHECK(ep.pending_cmds() == 2);
+    for(size_t i = 0; i < 3; ++i)
+    {
+        ZB_CHECK(zb_host::sent().size() == i + 1);
+        zb_host::confirm(i);
+    }
+    ZB_CHECK(sent_arg(0) == 0xa0 && sent_arg(1) == 0xb0 && sent_arg(2) == 0xc0);
+    ZB_CHECK(g_Statuses.size() == 3);
+    ZB_CHECK(ep.available_cmd_bufs() == 1);
+}
+
+//the coroutine resumed by the failure of a deferred command sends a new one: the failed command must not be sent again
+ZB_TEST(failure_callback_sends_again)
+{
+    init_device();
+    send(0xa0);
+    send(0xb0);
+    send(0xc0);
+    g_ResendOnFailure = true;
+    zb_host::fail_sends(1);
+    zb_host::confirm(0);//A done: B is sent and fails, its callback queues D, C goes out
+    ZB_CHECK(g_Statuses.size() == 2);
+    ZB_CHECK(g_Statuses[0].arg == 0xa0 && g_Statuses[0].status == RET_OK);
+    ZB_CHECK(g_Statuses[1].arg == 0xb0 && g_Statuses[1].status != RET_OK);
+    ZB_CHECK(zb_host::sent().size() == 2 && sent_arg(1) == 0xc0);
+    ZB_CHECK(ep.pending_cmds() == 1);
+    zb_host::confirm(1);
+    ZB_CHECK(zb_host::sent().size() == 3 && sent_arg(2) == 0xdd);
+    zb_host::confirm(2);
+    ZB_CHECK(g_Statuses.size() == 4);
+    ZB_CHECK(ep.pending_cmds() == 0 && ep.available_cmd_bufs() == 1);
+}
+
+ZB_TEST(canceled_cmds_are_skipped)
+{
+    init_device();
+    ZB_CHECK(ep.send_cmd<&zb::queue_cluster_t::out0>(uint8_t(0xa0)));
+    auto b = ep.send_cmd<&zb::queue_cluster_t::out0>(uint8_t(0xb0));
+    ZB_CHECK(ep.send_cmd<&zb::queue_cluster_t::out0>(uint8_t(0xc0)));
+    ZB_CHECK(b && ep.cancel_cmd(*b));
+    zb_host::confirm(0);
+    ZB_CHECK(zb_host::sent().size() == 2 && sent_arg(1) == 0xc0);
+    zb_host::confirm(1);
+    ZB_CHECK(ep.pending_cmds() == 0 && ep.available_cmd_bufs() == 1);
+}
+
+ZB_TEST_MAIN()
@@ -0,0 +1,71 @@
+//Runtime handler nodes: notification nodes (g_List) and indexed ones (attr_handler_registry_t) are each called once
+#include <cstring>
+#include "test.hpp"
+#include "nrfzbcpp/zb_main.hpp"
+
+namespace
+{
+    int g_SetCalls = 0;
+    int g_NoReportCalls = 0;
+    int g_ReportCalls = 0;
+    void on_set(zb_zcl_set_attr_value_param_t*, zb_zcl_device_callback_param_t*) { ++g_SetCalls; }
+    void on_no_report(zb_uint8_t, zb_uint16_t, zb_uint16_t) { ++g_NoReportCalls; }
+    void on_report(zb_zcl_addr_t*, zb_uint8_t, zb_uint16_t, zb_uint16_t, zb_uint8_t, zb_uint8_t*) { ++g_ReportCalls; }
+
+    constexpr zb::ep_cluster_attribute_desc_t kTemp{.ep = 1, .cluster = 0x0402, .attribute = 0};
+
+    zb::attr_handler_registry_t<zb::indexed_set_attr_val_handling_node_t, 8> g_SetHandlers;
+    zb::attr_handler_registry_t<zb::indexed_no_report_handling_node_t, 8> g_NoReportHandlers;
+    zb::attr_handler_registry_t<zb::indexed_report_handling_node_t, 8> g_ReportHandlers;
+
+    zb_bufid_t make_set_attr_buf(uint8_t ep, uint16_t cluster, uint16_t attr)
+    {
+        zb_bufid_t buf = zb_buf_get_out();
+        auto *p = ZB_BUF_GET_PARAM(buf, zb_zcl_device_callback_param_t);
+        *p = {};
+        p->device_cb_id = ZB_ZCL_SET_ATTR_VALUE_CB_ID;
+        p->endpoint = ep;
+        p->cb_param.set_attr_value_param.cluster_id = cluster;
+        p->cb_param.set_attr_value_param.attr_id = attr;
+        return buf;
+    }
+
+    void deliver_all()
+    {
+        g_SetCalls = g_NoReportCalls = g_ReportCalls = 0;
+        zb_bufid_t b = make_set_attr_buf(kTemp.ep, kTemp.cluster, kTemp.attribute);
+        zb::tpl_device_cb<>(b);
+        zb_buf_free(b);
+        zb::tpl_no_report_cb<>(kTemp.ep, kTemp.cluster, kTemp.attribute);
+        uint16_t v = 0;
+        zb::tpl_report_cb<>(nullptr, kTemp.ep, kTemp.cluster, kTemp.attribute, ZB_ZCL_ATTR_TYPE_S16, (zb_uint8_t*)&v);
+    }
+}
+
+//a node in the registry used to stay in its g_List as well and was called twice
+ZB_TEST(indexed_nodes_called_once)
+{
+    zb::indexed_set_attr_val_handling_node_t set{.h = {kTemp, on_set}};
+    zb::indexed_no_report_handling_node_t no_report{.h = {kTemp, on_no_report}};
+    zb::indexed_report_handling_node_t report{.h = {kTemp, on_report}};
+    ZB_CHECK(g_SetHandlers.add(set) && g_NoReportHandlers.add(no_report) && g_ReportHandlers.add(report));
+    deliver_all();
+    ZB_CHECK(g_SetCalls == 1 && g_NoReportCalls == 1 && g_ReportCalls == 1);
+    ZB_CHECK(g_SetHandlers.remove(set) && g_NoReportHandlers.remove(no_report) && g_ReportHandlers.remove(report));
+    deliver_all();
+    ZB_CHECK(g_SetCalls == 0 && g_NoReportCalls == 0 && g_ReportCalls == 0);
+}
+
+ZB_TEST(notification_nodes_called_once)
+{
+    zb::set_attr_val_handling_node_t set;
+    set.h = {kTemp, on_set};
+    zb::no_report_handling_node_t no_report;
+    no_report.h = {kTemp, on_no_report};
+    zb::report_handling_node_t report;
+    report.h = {kTemp, on_report};
+    deliver_all();
+    ZB_CHECK(g_SetCalls == 1 && g_NoReportCalls == 1 && g_ReportCalls == 1);
+}
+
+ZB_TEST_MAIN()
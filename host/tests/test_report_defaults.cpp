@@ -0,0 +1,82 @@
+//Declared reporting defaults (attribute_t::report): installed unless a coordinator has configured the reporting
+#include <cstring>
+#include "test.hpp"
+#include "nrfzbcpp/zb_main.hpp"
+
+namespace zb
+{
+    struct report_cluster_t
+    {
+        int16_t value;
+    };
+
+    template<> struct zcl_description_t<report_cluster_t> {
+        static constexpr auto get()
+        {
+            using T = report_cluster_t;
+            return cluster_t<
+                {.id = 0xfc60},
+                attributes_t<attribute_t{.m = &T::value, .id = 0x0000, .a = access_t::RP, .report = {.min_interval = 30, .max_interval = 600, .delta = 50}}>{}
+            >{};
+        }
+    };
+}
+
+namespace
+{
+    constexpr zb_host::attr_key_t kKey{.ep = 1, .cluster = 0xfc60, .attr = 0};
+
+    //what ZBOSS puts into its table for a reportable attribute: its own intervals, no delta
+    zb_zcl_reporting_info_t& zboss_entry()
+    {
+        zb_zcl_reporting_info_t r{};
+        r.direction = ZB_ZCL_CONFIGURE_REPORTING_SEND_REPORT;
+        r.ep = kKey.ep;
+        r.cluster_id = kKey.cluster;
+        r.attr_id = kKey.attr;
+        r.u.send_info.min_interval = r.u.send_info.def_min_interval = 1;
+        r.u.send_info.max_interval = r.u.send_info.def_max_interval = 0xfffe;
+        return zb_host::reporting_info()[kKey] = r;
+    }
+
+    void install() { zb::install_report_defaults<zb::report_cluster_t, 1>(); }
+
+    bool has_defaults()
+    {
+        auto const& si = zb_host::reporting_info().at(kKey).u.send_info;
+        return si.min_interval == 30 && si.max_interval == 600 && si.def_min_interval == 30 && si.def_max_interval == 600 && si.delta.s16 == 50;
+    }
+}
+
+ZB_TEST(defaults_installed)
+{
+    zb_host::reporting_info().clear();
+    install();
+    ZB_CHECK(has_defaults());
+    zboss_entry();
+    install();
+    ZB_CHECK(has_defaults());
+    //restored from NVRAM as installed: installed again
+    install();
+    ZB_CHECK(has_defaults());
+}
+
+ZB_TEST(configured_intervals_kept)
+{
+    auto &si = zboss_entry().u.send_info;
+    si.min_interval = 5;
+    install();
+    auto const& cur = zb_host::reporting_info().at(kKey).u.send_info;
+    ZB_CHECK(cur.min_interval == 5 && cur.max_interval == 0xfffe);
+}
+
+//Configure Reporting with the default intervals and only another delta used to be overwritten
+ZB_TEST(configured_delta_kept)
+{
+    zboss_entry().u.send_info.delta.s16 = 7;
+    install();
+    auto const& cur = zb_host::reporting_info().at(kKey).u.send_info;
+    ZB_CHECK(cur.delta.s16 == 7 && cur.min_interval == 1 && cur.max_interval == 0xfffe);
+}
+
+ZB_TEST_MAIN()
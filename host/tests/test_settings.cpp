@@ -0,0 +1,229 @@
+//persistent_settings_manager_t: write-behind batches saved from the work queue, flush() on shutdown/leave signals,
+//loading the settings blob (legacy per-entry keys, blobs of a larger layout)
+#include <cstring>
+#include "test.hpp"
+#include "nrfzbcpp/zb_main.hpp"
+#include "nrfzbcpp/zb_settings.hpp"
+#include "nrfzbcpp/zb_signals.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    uint16_t g_A = 0;
+    uint32_t g_B = 0;
+    //entry names must be constexpr char arrays
+    constexpr char kNameA[] = "zigbee/a";
+    constexpr char kNameB[] = "zigbee/b";
+
+    using wb_settings_t = zb::persistent_settings_manager_t<zb::settings_cfg_t{.off = 7, .write_behind_ms = 100},
+          zb::settings_entry_t{kNameA, g_A},
+          zb::settings_entry_t{kNameB, g_B}>;
+
+    void set(uint16_t a, uint32_t b)
+    {
+        g_A = a;
+        g_B = b;
+        wb_settings_t::make_on_changed<nullptr>("zigbee/a")(nullptr, nullptr);
+        wb_settings_t::make_on_changed<nullptr>("zigbee/b")(nullptr, nullptr);
+    }
+
+    template<class T>
+    bool stored(const char *name, T v)
+    {
+        auto &s = zb_host::settings_store();
+        auto i = s.find(name);
+        return i != s.end() && i->second.size() == sizeof(T) && !std::memcmp(i->second.data(), &v, sizeof(T));
+    }
+}
+
+//the alarm only queues the save: flash writes happen on the system work queue
+ZB_TEST(write_behind_saves_from_work_queue)
+{
+    zb_host::settings_store().clear();
+    size_t saves = zb_host::stats().settings_saves;
+    set(1, 2);
+    set(3, 4);
+    ZB_CHECK(wb_settings_t::has_unsaved());
+    zb_host::advance_ms(150);
+    ZB_CHECK(zb_host::stats().settings_saves == saves);
+    ZB_CHECK(zb_host::run_work() == 1);
+    ZB_CHECK(zb_host::stats().settings_saves == saves + 2);
+    ZB_CHECK(stored("zigbee/a", uint16_t(3)) && stored("zigbee/b", uint32_t(4)));
+    ZB_CHECK(!wb_settings_t::has_unsaved());
+}
+
+//flush() saves right away, nothing is left for the alarm or the work queue
+ZB_TEST(flush_saves_right_away)
+{
+    zb_host::settings_store().clear();
+    set(5, 6);
+    wb_settings_t::flush();
+    ZB_CHECK(stored("zigbee/a", uint16_t(5)) && stored("zigbee/b", uint32_t(6)));
+    ZB_CHECK(!wb_settings_t::has_unsaved());
+    size_t saves = zb_host::stats().settings_saves;
+    zb_host::advance_ms(1000);
+    zb_host::run_work();
+    ZB_CHECK(zb_host::stats().settings_saves == saves);
+}
+
+namespace
+{
+    std::atomic<bool> g_InSave{false};
+    std::atomic<bool> g_FlushCalled{false};
+    //the work queue is in the middle of a save when flush() gets called, and takes a while to finish
+    int slow_save(const char *)
+    {
+        if (!g_InSave.exchange(true))
+        {
+            while(!g_FlushCalled.load())
+                std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return 0;
+    }
+}
+
+//flush() used to return right away while the work queue was saving: the save on shutdown wasn't guaranteed
+ZB_TEST(flush_waits_for_the_work_queue)
+{
+    zb_host::settings_store().clear();
+    set(7, 8);
+    zb_host::advance_ms(150);
+    zb_host::set_settings_save_hook(&slow_save);
+    std::thread work([]{ zb_host::run_work(); });
+    while(!g_InSave.load())
+        std::this_thread::yield();
+    g_FlushCalled = true;
+    wb_settings_t::flush();
+    ZB_CHECK(stored("zigbee/a", uint16_t(7)) && stored("zigbee/b", uint32_t(8)));
+    ZB_CHECK(!wb_settings_t::has_unsaved());
+    work.join();
+    zb_host::set_settings_save_hook(nullptr);
+}
+
+namespace
+{
+    int fail_b(const char *name) { return std::strcmp(name, "zigbee/b") ? 0 : -EIO; }
+}
+
+//a failed save used to drop the dirty bit: the change was never written
+ZB_TEST(failed_save_stays_unsaved)
+{
+    zb_host::settings_store().clear();
+    set(9, 10);
+    zb_host::set_settings_save_hook(&fail_b);
+    wb_settings_t::flush();
+    ZB_CHECK(stored("zigbee/a", uint16_t(9)) && !zb_host::settings_store().contains("zigbee/b"));
+    ZB_CHECK(wb_settings_t::has_unsaved());
+    zb_host::set_settings_save_hook(nullptr);
+    size_t saves = zb_host::stats().settings_saves;
+    wb_settings_t::flush();
+    ZB_CHECK(stored("zigbee/b", uint32_t(10)));
+    ZB_CHECK(zb_host::stats().settings_saves == saves + 1);//only the one that failed
+    ZB_CHECK(!wb_settings_t::has_unsaved());
+}
+
+//gcc 12 rejects function pointers inside class-type template arguments (see README, Known issues)
+#if defined(__clang__) || __GNUC__ >= 13
+namespace
+{
+    zb_ret_t signal(zb_zdo_app_signal_type_t sig)
+    {
+        zb_bufid_t b = zb_buf_get_out();
+        auto *pHdr = static_cast<zb_zdo_app_signal_hdr_t*>(zb_buf_initial_alloc(b, sizeof(zb_zdo_app_signal_hdr_t) + sizeof(zb_zdo_signal_leave_params_t)));
+        pHdr->sig_type = sig;
+        return zb::tpl_signal_handler<zb::sig_handlers_t{.flush_settings = &wb_settings_t::flush}>(b);
+    }
+}
+
+ZB_TEST(flush_on_ready_to_shut_and_leave)
+{
+    for(auto sig : {ZB_SIGNAL_READY_TO_SHUT, ZB_ZDO_SIGNAL_LEAVE})
+    {
+        zb_host::settings_store().clear();
+        set(uint16_t(sig), 5);
+        signal(sig);
+        ZB_CHECK(stored("zigbee/a", uint16_t(sig)) && stored("zigbee/b", uint32_t(5)));
+        ZB_CHECK(!wb_settings_t::has_unsaved());
+    }
+}
+#endif
+
+namespace
+{
+    constexpr char kBlobName[] = "zigbee/cfg";
+    constexpr char kNamePad[] = "zigbee/pad";
+    uint16_t g_BlobA = 0;
+    uint32_t g_BlobB = 0;
+    //the same entries, written by a firmware with one more (large) entry
+    uint16_t g_BigA = 0;
+    uint32_t g_BigB = 0;
+    std::array<uint8_t, 64> g_BigPad{};
+
+    //the directory and data of a and b fit in 48 bytes, the pad doesn't
+    using blob_settings_t = zb::persistent_settings_manager_t<zb::settings_cfg_t{.off = 7, .blob_name = kBlobName, .blob_capacity = 48},
+          zb::settings_entry_t{kNameA, g_BlobA},
+          zb::settings_entry_t{kNameB, g_BlobB}>;
+    using big_blob_settings_t = zb::persistent_settings_manager_t<zb::settings_cfg_t{.off = 7, .blob_name = kBlobName},
+          zb::settings_entry_t{kNameA, g_BigA},
+          zb::settings_entry_t{kNameB, g_BigB},
+          zb::settings_entry_t{kNamePad, g_BigPad}>;
+
+    int load_blob_settings() { return zb_host::settings_load_subtree("zigbee", &blob_settings_t::zigbee_settings_set); }
+}
+
+//a newer firmware's blob is cut to blob_capacity: the fields complete in there are taken, the blob is saved again in our layout
+ZB_TEST(larger_blob_is_cut_to_known_fields)
+{
+    zb_host::settings_store().clear();
+    g_BigA = 11;
+    g_BigB = 22;
+    g_BigPad.fill(0xaa);
+    ZB_CHECK(big_blob_settings_t::zigbee_settings_export(&settings_save_one) == 0);
+    ZB_CHECK(zb_host::settings_store()["zigbee/cfg"].size() > 48);
+    ZB_CHECK(load_blob_settings() == 0);
+    ZB_CHECK(g_BlobA == 11 && g_BlobB == 22);
+    ZB_CHECK(blob_settings_t::zigbee_settings_commit() == 0);
+    ZB_CHECK(zb_host::settings_store()["zigbee/cfg"].size() <= 48);
+}
+
+//per-entry keys left over from a firmware without the blob don't override a valid blob, and get removed
+ZB_TEST(legacy_keys_after_blob_are_ignored)
+{
+    zb_host::settings_store().clear();
+    g_BlobA = 1;
+    g_BlobB = 2;
+    ZB_CHECK(blob_settings_t::zigbee_settings_export(&settings_save_one) == 0);
+    ZB_CHECK(load_blob_settings() == 0);
+    zb_host::settings_store().clear();
+    uint16_t legacyA = 999;
+    settings_save_one("zigbee/a", &legacyA, sizeof(legacyA));
+    ZB_CHECK(load_blob_settings() == 0);
+    ZB_CHECK(g_BlobA == 1);
+    ZB_CHECK(blob_settings_t::zigbee_settings_commit() == 0);
+    ZB_CHECK(!zb_host::settings_store().contains("zigbee/a"));
+    ZB_CHECK(zb_host::settings_store().contains("zigbee/cfg"));
+}
+
+//a legacy key loaded before a valid blob ("zigbee/a" < "zigbee/cfg") used to be forgotten: it was never removed
+ZB_TEST(legacy_keys_before_blob_are_removed)
+{
+    zb_host::settings_store().clear();
+    g_BlobA = 3;
+    g_BlobB = 4;
+    ZB_CHECK(blob_settings_t::zigbee_settings_export(&settings_save_one) == 0);
+    uint16_t legacyA = 999;
+    settings_save_one("zigbee/a", &legacyA, sizeof(legacyA));
+    size_t saves = zb_host::stats().settings_saves;
+    ZB_CHECK(load_blob_settings() == 0);
+    ZB_CHECK(g_BlobA == 3 && g_BlobB == 4);
+    ZB_CHECK(blob_settings_t::zigbee_settings_commit() == 0);
+    ZB_CHECK(zb_host::stats().settings_saves == saves + 1);
+    ZB_CHECK(!zb_host::settings_store().contains("zigbee/a"));
+    ZB_CHECK(zb_host::settings_store().contains("zigbee/cfg"));
+}
+
+ZB_TEST_MAIN()
@@ -0,0 +1,230 @@
+//timer_wheel_t against a reference model: random arm/cancel/advance on a virtual clock,
+//re-arming and cancelling from inside the handlers, around the 32-bit wrap-around
+#include "test.hpp"
+#include "nrfzbcpp/zb_timer_wheel.hpp"
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using tick_t = zb::timer_node_t::tick_t;
+
+    tick_t g_Now = 0;
+    bool g_Scheduled = false;
+    tick_t g_ScheduledAt = 0;
+    size_t g_FailSchedules = 0;
+
+    struct virtual_clock_t
+    {
+        static tick_t now() { return g_Now; }
+        static bool schedule(tick_t delay)
+        {
+            if (g_FailSchedules)
+            {
+                --g_FailSchedules;
+                return false;
+            }
+            g_Scheduled = true;
+            g_ScheduledAt = g_Now + delay;
+            return true;
+        }
+    };
+
+    using wheel_t = zb::timer_wheel_t<virtual_clock_t>;
+
+    //the model: what is armed and when it's due
+    struct model_timer_t: zb::timer_node_t
+    {
+        bool armed = false;
+        tick_t due = 0;//m_Expires as the wheel accepted it
+    };
+
+    struct fixture_t
+    {
+        wheel_t wheel;
+        std::vector<model_timer_t> timers;
+        std::mt19937 rng;
+        size_t fired = 0;
+        bool failed = false;
+
+        fixture_t(uint32_t seed, size_t n): timers(n), rng(seed)
+        {
+            for(auto &t : timers)
+                t.m_Handler = &on_fire;
+        }
+
+        static fixture_t *g_pCur;
+
+        model_timer_t& any() { return timers[rng() % timers.size()]; }
+
+        void arm(model_timer_t &t, tick_t delay, tick_t slack = 0)
+        {
+            t.m_Slack = slack;
+            wheel.arm(t, g_Now + delay);
+            //a deadline in the past is moved to the wheel time, never later
+            ZB_CHECK(t.m_Expires - (g_Now + delay) <= 1 || delay == 0);
+            t.due = t.m_Expires;
+            t.armed = true;
+        }
+
+        void cancel(model_timer_t &t)
+        {
+            wheel.cancel(t);
+            t.armed = false;
+        }
+
+        static void on_fire(zb::timer_node_t &n)
+        {
+            fixture_t &f = *g_pCur;
+            auto &t = static_cast<model_timer_t&>(n);
+            //fires once, within its window [due, due + slack]
+            if (!t.armed || int32_t(g_Now - t.due) < 0 || g_Now - t.due > t.m_Slack)
+            {
+                if (!std::exchange(f.failed, true))
+                    printf("  timer fired at %u: armed=%d due=%u slack=%u\n", g_Now, t.armed, t.due, t.m_Slack);
+            }
+            t.armed = false;
+            ++f.fired;
+            if (f.rng() % 3 == 0)
+                f.arm(f.any(), 1 + f.rng() % 5);
+            if (f.rng() % 4 == 0)
+                f.cancel(f.any());
+        }
+
+        //the backend alarm must be due no later than the earliest window end of the armed timers
+        bool schedule_covers_armed() const
+        {
+            for(auto const& t : timers)
+            {
+                if (t.armed && (!g_Scheduled || int32_t(g_ScheduledAt - (t.due + t.m_Slack)) > 0))
+                {
+                    printf("  due %u (+%u) not covered: scheduled=%d at %u, now %u\n", t.due, t.m_Slack, g_Scheduled, g_ScheduledAt, g_Now);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //moves the clock to 'target', running the wheel whenever the backend alarm is due
+        void advance_to(tick_t target)
+        {
+            for(size_t guard = 0; g_Scheduled && int32_t(g_ScheduledAt - target) <= 0; ++guard)
+            {
+                if (guard > 100000)
+                {
+                    ZB_CHECK(!"the wheel keeps re-scheduling");
+                    return;
+                }
+                if (int32_t(g_ScheduledAt - g_Now) > 0)
+                    g_Now = g_ScheduledAt;
+                g_Scheduled = false;
+                wheel.run(g_Now);
+            }
+            g_Now = target;
+        }
+
+        tick_t random_delay()
+        {
+            switch(rng() % 4)
+            {
+                case 0: return rng() % 20;
+                case 1: return rng() % 5000;
+                case 2: return rng() % 200000;
+                default: return rng() % (1u << 29);
+            }
+        }
+
+        void run(size_t steps, bool with_slack)
+        {
+            g_pCur = this;
+            for(size_t step = 0; step < steps && !failed; ++step)
+            {
+                uint32_t op = rng() % 10;
+                if (op < 3)
+                    arm(any(), random_delay(), with_slack && rng() % 2 ? rng() % 64 : 0);
+                else if (op < 4)
+                    cancel(any());
+                else
+                {
+                    if (!schedule_covers_armed())
+                    {
+                        failed = true;
+                        break;
+                    }
+                    advance_to(g_Now + (rng() % 3 == 0 ? rng() % 300000 : rng() % 50));
+                }
+            }
+            //everything still armed fires eventually
+            advance_to(g_Now + (1u << 30));
+            for(auto const& t : timers)
+                ZB_CHECK(!t.armed);
+            ZB_CHECK(!failed);
+            ZB_CHECK(wheel.empty());
+            g_pCur = nullptr;
+        }
+    };
+    fixture_t *fixture_t::g_pCur = nullptr;
+
+    void run_model(tick_t start, bool with_slack)
+    {
+        for(uint32_t seed = 1; seed <= 4; ++seed)
+        {
+            g_Now = start;
+            g_Scheduled = false;
+            fixture_t f(seed, 64);
+            f.run(100000, with_slack);
+            ZB_CHECK(f.fired > 0);
+        }
+    }
+}
+
+ZB_TEST(wheel_matches_model)
+{
+    run_model(0, false);
+}
+
+ZB_TEST(wheel_matches_model_across_wraparound)
+{
+    run_model(tick_t(-1) - 100000, false);
+}
+
+ZB_TEST(wheel_matches_model_with_slack)
+{
+    run_model(0x12345678, true);
+}
+
+ZB_TEST(wheel_past_deadline_fires_on_next_run)
+{
+    g_Now = 1000;
+    g_Scheduled = false;
+    wheel_t wheel;
+    model_timer_t t;
+    static bool g_Fired = false;
+    t.m_Handler = [](zb::timer_node_t &){ g_Fired = true; };
+    wheel.arm(t, g_Now - 10);
+    ZB_CHECK(g_Scheduled && g_ScheduledAt == g_Now);
+    wheel.run(g_Now);
+    ZB_CHECK(g_Fired && !t.IsArmed() && wheel.empty());
+}
+
+//a backend alarm that can't be scheduled disarms the node, the next arm schedules again
+ZB_TEST(wheel_failed_schedule_disarms)
+{
+    g_Now = 2000;
+    g_Scheduled = false;
+    wheel_t wheel;
+    model_timer_t a, b;
+    static int g_Fired = 0;
+    a.m_Handler = b.m_Handler = [](zb::timer_node_t &){ ++g_Fired; };
+    g_FailSchedules = 1;
+    ZB_CHECK(!wheel.arm(a, g_Now + 10));
+    ZB_CHECK(!a.IsArmed() && wheel.empty() && !g_Scheduled);
+    ZB_CHECK(wheel.arm(b, g_Now + 20));
+    ZB_CHECK(g_Scheduled && g_ScheduledAt == g_Now + 20);
+    g_Now += 20;
+    wheel.run(g_Now);
+    ZB_CHECK(g_Fired == 1 && wheel.empty());
+}
+
+ZB_TEST_MAIN()
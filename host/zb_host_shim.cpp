@@ -0,0 +1,837 @@
+//Host implementation of the ZBOSS/Zephyr subset declared in host/include.
+//Good enough to drive the header-only pieces of nrfzbcpp in tests and benchmarks, not a simulator.
+#include "zb_host.hpp"
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/reboot.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/regulator.h>
+#include <zigbee/zigbee_app_utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace zb_host
+{
+    namespace
+    {
+        constexpr size_t kBufSize = 128;
+        constexpr size_t kTailSize = 64;
+
+        struct buf_t
+        {
+            bool used;
+            zb_ret_t status;
+            zb_uint_t len;
+            uint8_t frame_ctl;
+            uint8_t data[kBufSize];
+            alignas(8) uint8_t tail[kTailSize];
+        };
+
+        struct callback_t
+        {
+            zb_callback_t cb;
+            zb_callback2_t cb2;
+            zb_uint8_t param;
+            zb_uint16_t arg;
+        };
+
+        struct delayed_buf_t
+        {
+            zb_callback2_t cb;
+            zb_uint16_t arg;
+        };
+
+        struct cluster_handlers_t
+        {
+            uint16_t cluster;
+            uint8_t role;
+            zb_zcl_cluster_check_value_t check_value;
+            zb_zcl_cluster_write_attr_hook_t write_attr_hook;
+            zb_zcl_cluster_handler_t handler;
+        };
+
+        struct state_t
+        {
+            std::atomic<zb_time_t> now{1000};//read by ZB_TIMER_GET from any thread
+            std::multimap<zb_time_t, callback_t> alarms;
+            size_t fail_alarms = 0;
+
+            std::mutex callbacks_lock;
+            std::deque<callback_t> callbacks;
+            size_t fail_callbacks = 0;
+
+            std::deque<k_work*> work;
+            std::atomic<k_work*> running_work{nullptr};
+            size_t fail_work_submits = 0;
+
+            buf_t bufs[kMaxBufs + 1];//0 is ZB_BUF_INVALID
+            size_t buf_pool_size = kMaxBufs;
+            size_t bufs_in_use = 0;
+            std::deque<delayed_buf_t> delayed_bufs;
+
+            std::vector<sent_packet_t> sent;
+            uint8_t seq_num = 0;
+            size_t fail_sends = 0;
+
+            zb_af_device_ctx_t *pDevice = nullptr;
+            std::vector<cluster_handlers_t> handlers;
+            std::vector<attr_key_t> reported;
+            std::map<attr_key_t, zb_zcl_reporting_info_t> reporting_info;
+            stats_t stats;
+
+            std::map<std::string, std::vector<uint8_t>> settings;
+            settings_save_hook_t settings_save_hook = nullptr;
+
+            int32_t adc_raw = 0;
+            int regulators = 0;
+        };
+
+        state_t& st()
+        {
+            static state_t s;
+            return s;
+        }
+
+        buf_t& buf(zb_bufid_t id)
+        {
+            ZB_ASSERT(id != ZB_BUF_INVALID && id <= kMaxBufs && st().bufs[id].used);
+            return st().bufs[id];
+        }
+
+        zb_bufid_t alloc_buf()
+        {
+            auto &s = st();
+            if (s.bufs_in_use >= s.buf_pool_size)
+                return ZB_BUF_INVALID;
+            for(zb_bufid_t i = 1; i <= kMaxBufs; ++i)
+            {
+                if (!s.bufs[i].used)
+                {
+                    s.bufs[i] = buf_t{.used = true};
+                    ++s.bufs_in_use;
+                    return i;
+                }
+            }
+            return ZB_BUF_INVALID;
+        }
+
+        void queue_callback(callback_t const& c)
+        {
+            std::lock_guard l(st().callbacks_lock);
+            st().callbacks.push_back(c);
+        }
+
+        //payload size of an attribute value as ZBOSS stores it
+        size_t attr_value_size(zb_uint8_t type, const zb_uint8_t *value)
+        {
+            switch(type)
+            {
+                case ZB_ZCL_ATTR_TYPE_OCTET_STRING:
+                case ZB_ZCL_ATTR_TYPE_CHAR_STRING:
+                case ZB_ZCL_ATTR_TYPE_ARRAY:
+                case ZB_ZCL_ATTR_TYPE_CUSTOM_32ARRAY:
+                    return size_t(value[0]) + 1;
+                case ZB_ZCL_ATTR_TYPE_LONG_OCTET_STRING:
+                case ZB_ZCL_ATTR_TYPE_LONG_CHAR_STRING:
+                    return size_t(value[0] | (value[1] << 8)) + 2;
+                case ZB_ZCL_ATTR_TYPE_24BIT: case ZB_ZCL_ATTR_TYPE_24BITMAP: case ZB_ZCL_ATTR_TYPE_U24: case ZB_ZCL_ATTR_TYPE_S24:
+                    return 3;
+                case ZB_ZCL_ATTR_TYPE_40BIT: case ZB_ZCL_ATTR_TYPE_40BITMAP: case ZB_ZCL_ATTR_TYPE_U40: case ZB_ZCL_ATTR_TYPE_S40:
+                    return 5;
+                case ZB_ZCL_ATTR_TYPE_48BIT: case ZB_ZCL_ATTR_TYPE_48BITMAP: case ZB_ZCL_ATTR_TYPE_U48: case ZB_ZCL_ATTR_TYPE_S48:
+                    return 6;
+                case ZB_ZCL_ATTR_TYPE_56BIT: case ZB_ZCL_ATTR_TYPE_56BITMAP: case ZB_ZCL_ATTR_TYPE_U56: case ZB_ZCL_ATTR_TYPE_S56:
+                    return 7;
+                case ZB_ZCL_ATTR_TYPE_64BIT: case ZB_ZCL_ATTR_TYPE_64BITMAP: case ZB_ZCL_ATTR_TYPE_U64: case ZB_ZCL_ATTR_TYPE_S64:
+                case ZB_ZCL_ATTR_TYPE_DOUBLE: case ZB_ZCL_ATTR_TYPE_IEEE_ADDR:
+                    return 8;
+                case ZB_ZCL_ATTR_TYPE_128_BIT_KEY:
+                    return 16;
+                case ZB_ZCL_ATTR_TYPE_16BIT: case ZB_ZCL_ATTR_TYPE_16BITMAP: case ZB_ZCL_ATTR_TYPE_U16: case ZB_ZCL_ATTR_TYPE_S16:
+                case ZB_ZCL_ATTR_TYPE_16BIT_ENUM: case ZB_ZCL_ATTR_TYPE_SEMI: case ZB_ZCL_ATTR_TYPE_CLUSTER_ID: case ZB_ZCL_ATTR_TYPE_ATTRIBUTE_ID:
+                    return 2;
+                case ZB_ZCL_ATTR_TYPE_32BIT: case ZB_ZCL_ATTR_TYPE_32BITMAP: case ZB_ZCL_ATTR_TYPE_U32: case ZB_ZCL_ATTR_TYPE_S32:
+                case ZB_ZCL_ATTR_TYPE_SINGLE: case ZB_ZCL_ATTR_TYPE_TIME_OF_DAY: case ZB_ZCL_ATTR_TYPE_DATE: case ZB_ZCL_ATTR_TYPE_UTC_TIME:
+                case ZB_ZCL_ATTR_TYPE_BACNET_OID:
+                    return 4;
+                default:
+                    return 1;
+            }
+        }
+
+        zb_zcl_cluster_desc_t* find_cluster(uint8_t ep, uint16_t cluster, uint8_t role)
+        {
+            auto *pDev = st().pDevice;
+            if (!pDev)
+                return nullptr;
+            for(size_t e = 0; e < pDev->ep_count; ++e)
+            {
+                auto *pEp = pDev->ep_desc_list[e];
+                if (pEp->ep_id != ep)
+                    continue;
+                for(size_t c = 0; c < pEp->cluster_count; ++c)
+                {
+                    auto &cl = pEp->cluster_desc_list[c];
+                    if (cl.cluster_id == cluster && cl.role_mask == role)
+                        return &cl;
+                }
+            }
+            return nullptr;
+        }
+
+        cluster_handlers_t* find_handlers(uint16_t cluster, uint8_t role)
+        {
+            for(auto &h : st().handlers)
+                if (h.cluster == cluster && h.role == role)
+                    return &h;
+            return nullptr;
+        }
+    }
+
+    void reset(zb_time_t start)
+    {
+        auto &s = st();
+        s.now = start;
+        s.alarms.clear();
+        s.fail_alarms = 0;
+        {
+            std::lock_guard l(s.callbacks_lock);
+            s.callbacks.clear();
+            s.fail_callbacks = 0;
+        }
+        for(auto *w : s.work)
+            w->pending = false;
+        s.work.clear();
+        s.fail_work_submits = 0;
+        for(auto &b : s.bufs)
+            b.used = false;
+        s.buf_pool_size = kMaxBufs;
+        s.bufs_in_use = 0;
+        s.delayed_bufs.clear();
+        s.sent.clear();
+        s.fail_sends = 0;
+        s.reported.clear();
+        s.stats = {};
+        s.settings.clear();
+        s.settings_save_hook = nullptr;
+        s.adc_raw = 0;
+        s.regulators = 0;
+    }
+
+    /**********************************************************************/
+    /* Virtual clock and the ZBOSS scheduler                              */
+    /**********************************************************************/
+    zb_time_t now() { return st().now; }
+
+    bool run_next_alarm()
+    {
+        auto &s = st();
+        run_callbacks();
+        if (s.alarms.empty())
+            return false;
+        auto i = s.alarms.begin();
+        auto [t, c] = *i;
+        s.alarms.erase(i);
+        if (t > s.now)
+            s.now = t;
+        c.cb(c.param);
+        run_callbacks();
+        return true;
+    }
+
+    void advance(zb_time_t ticks)
+    {
+        auto &s = st();
+        zb_time_t target = s.now + ticks;
+        run_callbacks();
+        while(!s.alarms.empty() && s.alarms.begin()->first <= target)
+            run_next_alarm();
+        s.now = target;
+        run_callbacks();
+    }
+
+    size_t armed_alarms() { return st().alarms.size(); }
+
+    size_t run_callbacks()
+    {
+        auto &s = st();
+        size_t n = 0;
+        while(true)
+        {
+            callback_t c;
+            {
+                std::lock_guard l(s.callbacks_lock);
+                if (s.callbacks.empty())
+                    return n;
+                c = s.callbacks.front();
+                s.callbacks.pop_front();
+            }
+            if (c.cb2)
+                c.cb2(c.param, c.arg);
+            else
+                c.cb(c.param);
+            ++n;
+        }
+    }
+
+    void fail_alarms(size_t n) { st().fail_alarms = n; }
+
+    void fail_schedule_callbacks(size_t n)
+    {
+        std::lock_guard l(st().callbacks_lock);
+        st().fail_callbacks = n;
+    }
+
+    void fail_work_submits(size_t n) { st().fail_work_submits = n; }
+
+    size_t run_work()
+    {
+        auto &s = st();
+        size_t n = 0;
+        while(!s.work.empty())
+        {
+            auto *w = s.work.front();
+            s.work.pop_front();
+            w->pending = false;
+            s.running_work.store(w, std::memory_order_relaxed);
+            w->handler(w);
+            s.running_work.store(nullptr, std::memory_order_release);
+            ++n;
+        }
+        return n;
+    }
+
+    /**********************************************************************/
+    /* Buffers                                                            */
+    /**********************************************************************/
+    void set_buf_pool_size(size_t n) { st().buf_pool_size = std::min(n, kMaxBufs); }
+    size_t bufs_in_use() { return st().bufs_in_use; }
+
+    zb_bufid_t make_cmd_buf(uint8_t dst_ep, uint16_t cluster, uint8_t cmd_id, const uint8_t *payload, size_t len, bool disable_default_response)
+    {
+        zb_bufid_t id = zb_buf_get_in();
+        ZB_ASSERT(id != ZB_BUF_INVALID && len <= kBufSize);
+        if (len)
+            memcpy(zb_buf_initial_alloc(id, len), payload, len);
+        auto *pHdr = ZB_BUF_GET_PARAM(id, zb_zcl_parsed_hdr_t);
+        *pHdr = {};
+        pHdr->addr_data.common_data.dst_endpoint = dst_ep;
+        pHdr->cluster_id = cluster;
+        pHdr->profile_id = ZB_AF_HA_PROFILE_ID;
+        pHdr->cmd_id = cmd_id;
+        pHdr->cmd_direction = ZB_ZCL_FRAME_DIRECTION_TO_SRV;
+        pHdr->seq_number = zb_host_zcl_next_seq_num();
+        pHdr->disable_default_response = disable_default_response;
+        return id;
+    }
+
+    /**********************************************************************/
+    /* Sent ZCL packets                                                   */
+    /**********************************************************************/
+    std::vector<sent_packet_t>& sent() { return st().sent; }
+    void fail_sends(size_t n) { st().fail_sends = n; }
+
+    void confirm(size_t i, uint8_t status)
+    {
+        auto &p = st().sent[i];
+        if (p.confirmed)
+            return;
+        p.confirmed = true;
+        auto *pStatus = ZB_BUF_GET_PARAM(p.buf, zb_zcl_command_send_status_t);
+        pStatus->status = status;
+        pStatus->dst_ep = p.dst_ep;
+        //the callback may send more packets and reallocate the log
+        auto cb = p.cb;
+        auto id = p.buf;
+        if (cb)
+            cb(id);
+        else
+            zb_buf_free(id);
+    }
+
+    void confirm_all(uint8_t status)
+    {
+        for(size_t i = 0; i < st().sent.size(); ++i)
+            confirm(i, status);
+    }
+
+    /**********************************************************************/
+    /* Device, attributes, reporting, cluster handlers                    */
+    /**********************************************************************/
+    void register_device(zb_af_device_ctx_t *pCtx)
+    {
+        auto &s = st();
+        s.pDevice = pCtx;
+        s.handlers.clear();
+        s.reporting_info.clear();
+        for(size_t e = 0; e < pCtx->ep_count; ++e)
+        {
+            auto *pEp = pCtx->ep_desc_list[e];
+            for(size_t c = 0; c < pEp->cluster_count; ++c)
+                if (auto init = pEp->cluster_desc_list[c].cluster_init)
+                    init();
+        }
+    }
+
+    zb_zcl_attr_t* find_attr(uint8_t ep, uint16_t cluster, uint8_t role, uint16_t attr)
+    {
+        auto *pCl = find_cluster(ep, cluster, role);
+        if (!pCl)
+            return nullptr;
+        for(size_t a = 0; a < pCl->attr_count; ++a)
+            if (pCl->attr_desc_list[a].id == attr)
+                return &pCl->attr_desc_list[a];
+        return nullptr;
+    }
+
+    stats_t& stats() { return st().stats; }
+    std::vector<attr_key_t>& reported() { return st().reported; }
+    std::map<attr_key_t, zb_zcl_reporting_info_t>& reporting_info() { return st().reporting_info; }
+
+    zb_bool_t deliver_cmd(zb_bufid_t buf, uint8_t role)
+    {
+        auto *pHdr = ZB_BUF_GET_PARAM(buf, zb_zcl_parsed_hdr_t);
+        auto *pH = find_handlers(pHdr->cluster_id, role);
+        if (!pH || !pH->handler)
+            return ZB_FALSE;
+        return pH->handler(buf);
+    }
+
+    zb_zcl_cluster_check_value_t check_value_handler(uint16_t cluster, uint8_t role)
+    {
+        auto *pH = find_handlers(cluster, role);
+        return pH ? pH->check_value : nullptr;
+    }
+
+    /**********************************************************************/
+    /* Settings                                                           */
+    /**********************************************************************/
+    std::map<std::string, std::vector<uint8_t>>& settings_store() { return st().settings; }
+    void set_settings_save_hook(settings_save_hook_t h) { st().settings_save_hook = h; }
+
+    int settings_load_subtree(const char *subtree, settings_set_t set)
+    {
+        struct reader_t
+        {
+            std::vector<uint8_t> const& v;
+            static ssize_t read(void *cb_arg, void *data, size_t len)
+            {
+                auto &r = *static_cast<reader_t*>(cb_arg);
+                len = std::min(len, r.v.size());
+                memcpy(data, r.v.data(), len);
+                return ssize_t(len);
+            }
+        };
+        const std::string prefix = std::string(subtree) + "/";
+        //copy: the handler may save/delete while loading
+        auto snapshot = st().settings;
+        for(auto const& [name, v] : snapshot)
+        {
+            if (name.compare(0, prefix.size(), prefix) != 0)
+                continue;
+            reader_t r{v};
+            if (int rc = set(name.c_str() + prefix.size(), v.size(), &reader_t::read, &r); rc != 0)
+                return rc;
+        }
+        return 0;
+    }
+
+    /**********************************************************************/
+    /* ADC / regulator                                                    */
+    /**********************************************************************/
+    void set_adc_raw(int32_t raw) { st().adc_raw = raw; }
+    int regulators_enabled() { return st().regulators; }
+}
+
+using namespace zb_host;
+
+extern "C"
+{
+    /**********************************************************************/
+    /* Buffers                                                            */
+    /**********************************************************************/
+    zb_bufid_t zb_buf_get_out(void) { return alloc_buf(); }
+    zb_bufid_t zb_buf_get_in(void) { return alloc_buf(); }
+
+    void zb_buf_free(zb_bufid_t id)
+    {
+        auto &s = st();
+        buf(id).used = false;
+        --s.bufs_in_use;
+        if (!s.delayed_bufs.empty())
+        {
+            auto d = s.delayed_bufs.front();
+            s.delayed_bufs.pop_front();
+            queue_callback({.cb2 = d.cb, .param = alloc_buf(), .arg = d.arg});
+        }
+    }
+
+    zb_ret_t zb_buf_get_out_delayed_ext(zb_callback2_t cb, zb_uint16_t arg, zb_uint16_t)
+    {
+        if (zb_bufid_t id = alloc_buf(); id != ZB_BUF_INVALID)
+            queue_callback({.cb2 = cb, .param = id, .arg = arg});
+        else
+            st().delayed_bufs.push_back({cb, arg});
+        return RET_OK;
+    }
+
+    void zb_buf_reuse(zb_bufid_t id)
+    {
+        auto &b = buf(id);
+        b.len = 0;
+        b.status = RET_OK;
+    }
+
+    void* zb_buf_begin(zb_bufid_t id) { return buf(id).data; }
+    zb_uint_t zb_buf_len(zb_bufid_t id) { return buf(id).len; }
+
+    void* zb_buf_initial_alloc(zb_bufid_t id, zb_uint_t size)
+    {
+        auto &b = buf(id);
+        ZB_ASSERT(size <= kBufSize);
+        b.len = size;
+        return b.data;
+    }
+
+    void* zb_buf_get_tail_func(zb_bufid_t id, zb_uint_t size)
+    {
+        ZB_ASSERT(size <= kTailSize);
+        return buf(id).tail;
+    }
+
+    zb_ret_t zb_buf_get_status(zb_bufid_t id) { return buf(id).status; }
+
+    /**********************************************************************/
+    /* ZCL                                                                */
+    /**********************************************************************/
+    zb_ret_t zb_zcl_set_attr_val(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t cluster_role, zb_uint16_t attr_id, zb_uint8_t *value, zb_bool_t check_access)
+    {
+        auto &s = st();
+        ++s.stats.set_attr_calls;
+        auto *pAttr = find_attr(ep, cluster_id, cluster_role, attr_id);
+        if (!pAttr)
+            return ZB_ZCL_STATUS_UNSUP_ATTRIB;
+        if (check_access && (pAttr->access & ZB_ZCL_ATTR_ACCESS_READ_ONLY) && !(pAttr->access & ZB_ZCL_ATTR_ACCESS_WRITE_ONLY))
+            return ZB_ZCL_STATUS_READ_ONLY;
+        size_t sz = attr_value_size(pAttr->type, value);
+        if (memcmp(pAttr->data_p, value, sz) != 0)
+        {
+            memcpy(pAttr->data_p, value, sz);
+            if (pAttr->access & ZB_ZCL_ATTR_ACCESS_REPORTING)
+                zb_zcl_mark_attr_for_reporting(ep, cluster_id, cluster_role, attr_id);
+        }
+        return ZB_ZCL_STATUS_SUCCESS;
+    }
+
+    zb_ret_t zb_zcl_mark_attr_for_reporting(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t, zb_uint16_t attr_id)
+    {
+        ++st().stats.marked_for_reporting;
+        st().reported.push_back({ep, cluster_id, attr_id});
+        return RET_OK;
+    }
+
+    zb_ret_t zb_zcl_put_reporting_info(zb_zcl_reporting_info_t *rep_info, zb_bool_t override)
+    {
+        attr_key_t k{rep_info->ep, rep_info->cluster_id, rep_info->attr_id};
+        auto &table = st().reporting_info;
+        if (!override && table.contains(k))
+            return RET_ALREADY_EXISTS;
+        table[k] = *rep_info;
+        return RET_OK;
+    }
+
+    zb_zcl_reporting_info_t* zb_zcl_find_reporting_info(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint8_t, zb_uint16_t attr_id)
+    {
+        auto &table = st().reporting_info;
+        auto i = table.find(attr_key_t{ep, cluster_id, attr_id});
+        return i == table.end() ? nullptr : &i->second;
+    }
+
+    zb_ret_t zb_zcl_add_cluster_handlers(zb_uint16_t cluster_id, zb_uint8_t cluster_role, zb_zcl_cluster_check_value_t check_value, zb_zcl_cluster_write_attr_hook_t write_attr_hook, zb_zcl_cluster_handler_t cluster_handler)
+    {
+        if (find_handlers(cluster_id, cluster_role))
+            return RET_ALREADY_EXISTS;
+        st().handlers.push_back({cluster_id, cluster_role, check_value, write_attr_hook, cluster_handler});
+        return RET_OK;
+    }
+
+    void* zb_zcl_start_command_header(zb_bufid_t id, zb_uint8_t frame_ctl, zb_uint16_t, zb_uint8_t cmd_id, zb_uint8_t *tsn)
+    {
+        auto &b = buf(id);
+        b.frame_ctl = frame_ctl;
+        b.data[0] = cmd_id;
+        if (tsn)
+            *tsn = zb_host_zcl_next_seq_num();
+        return b.data + 1;
+    }
+
+    zb_ret_t zb_zcl_finish_and_send_packet(zb_bufid_t id, void *end, zb_addr_u *, zb_uint8_t dst_addr_mode, zb_uint8_t dst_ep, zb_uint8_t ep, zb_uint16_t, zb_uint16_t cluster_id, zb_callback_t cb)
+    {
+        auto &b = buf(id);
+        if (st().fail_sends)
+        {
+            --st().fail_sends;
+            return RET_ERROR;
+        }
+        auto *pEnd = static_cast<uint8_t*>(end);
+        ZB_ASSERT(pEnd > b.data && pEnd <= b.data + kBufSize);
+        b.len = zb_uint_t(pEnd - b.data);
+        st().sent.push_back({.buf = id, .cluster = cluster_id, .ep = ep, .dst_ep = dst_ep, .addr_mode = dst_addr_mode, .frame_ctl = b.frame_ctl,
+                .payload = {b.data, pEnd}, .cb = cb});
+        return RET_OK;
+    }
+
+    /**********************************************************************/
+    /* Scheduler                                                          */
+    /**********************************************************************/
+    zb_ret_t zb_schedule_app_alarm(zb_callback_t cb, zb_uint8_t param, zb_time_t timeout_bi)
+    {
+        if (st().fail_alarms)
+        {
+            --st().fail_alarms;
+            return RET_NO_MEMORY;
+        }
+        st().alarms.insert({st().now + timeout_bi, callback_t{.cb = cb, .param = param}});
+        return RET_OK;
+    }
+
+    zb_ret_t zb_schedule_alarm_cancel(zb_callback_t cb, zb_uint8_t param, zb_uint8_t *p_param)
+    {
+        auto &alarms = st().alarms;
+        for(auto i = alarms.begin(); i != alarms.end(); ++i)
+        {
+            if (i->second.cb == cb && i->second.param == param)
+            {
+                if (p_param)
+                    *p_param = param;
+                alarms.erase(i);
+                return RET_OK;
+            }
+        }
+        return RET_NOT_FOUND;
+    }
+
+    zb_ret_t zb_schedule_app_callback(zb_callback_t cb, zb_uint8_t param)
+    {
+        queue_callback({.cb = cb, .param = param});
+        return RET_OK;
+    }
+
+    zb_ret_t zigbee_schedule_callback(zb_callback_t func, zb_uint8_t param)
+    {
+        auto &s = st();
+        std::lock_guard l(s.callbacks_lock);
+        if (s.fail_callbacks)
+        {
+            --s.fail_callbacks;
+            return RET_NO_MEMORY;
+        }
+        s.callbacks.push_back({.cb = func, .param = param});
+        return RET_OK;
+    }
+
+    zb_time_t zb_timer_get(void) { return st().now; }
+
+    /**********************************************************************/
+    /* Signals, misc                                                      */
+    /**********************************************************************/
+    zb_zdo_app_signal_type_t zb_get_app_signal(zb_bufid_t id, zb_zdo_app_signal_hdr_t **pp_hdr)
+    {
+        auto *pHdr = static_cast<zb_zdo_app_signal_hdr_t*>(zb_buf_begin(id));
+        if (pp_hdr)
+            *pp_hdr = pHdr;
+        return pHdr->sig_type;
+    }
+
+    zb_ret_t zigbee_default_signal_handler(zb_bufid_t) { return RET_OK; }
+
+    void zb_osif_abort(void) { abort(); }
+
+    int printk(const char *fmt, ...)
+    {
+        if (!getenv("ZB_HOST_VERBOSE"))
+            return 0;
+        va_list args;
+        va_start(args, fmt);
+        int r = vprintf(fmt, args);
+        va_end(args);
+        return r;
+    }
+
+    void zb_host_assert_failed(const char *file, int line, const char *expr)
+    {
+        fprintf(stderr, "%s:%d: ZB_ASSERT(%s) failed\n", file, line, expr);
+        abort();
+    }
+
+    struct zb_host_zcl_ctx_t* zb_host_zcl_ctx(void)
+    {
+        static zb_host_zcl_ctx_t ctx;
+        return &ctx;
+    }
+
+    zb_uint8_t zb_host_zcl_next_seq_num(void) { return st().seq_num++; }
+
+    void zb_host_zcl_process_command_finish(zb_bufid_t id, zb_zcl_parsed_hdr_t *, zb_uint8_t)
+    {
+        //no default response on the host
+        zb_buf_free(id);
+    }
+}
+
+/**********************************************************************/
+/* Zephyr                                                             */
+/**********************************************************************/
+k_tid_t k_current_get(void)
+{
+    static std::atomic<int> g_NextId{1};
+    thread_local k_thread t{g_NextId.fetch_add(1, std::memory_order_relaxed)};
+    return &t;
+}
+
+void k_work_init(struct k_work *work, k_work_handler_t handler)
+{
+    *work = {.handler = handler};
+}
+
+int k_work_submit(struct k_work *work)
+{
+    if (work->pending)
+        return 0;
+    if (st().fail_work_submits)
+    {
+        --st().fail_work_submits;
+        return -EBUSY;
+    }
+    work->pending = true;
+    st().work.push_back(work);
+    return 1;
+}
+
+bool k_work_flush(struct k_work *work, struct k_work_sync *)
+{
+    auto &s = st();
+    bool waited = false;
+    while(s.running_work.load(std::memory_order_acquire) == work)
+    {
+        waited = true;
+        std::this_thread::yield();
+    }
+    if (work->pending)
+    {
+        s.work.erase(std::find(s.work.begin(), s.work.end(), work));
+        work->pending = false;
+        work->handler(work);
+        waited = true;
+    }
+    return waited;
+}
+
+int32_t k_msleep(int32_t ms)
+{
+    st().now += ZB_MILLISECONDS_TO_BEACON_INTERVAL(ms);
+    return 0;
+}
+
+void sys_reboot(int)
+{
+    fprintf(stderr, "sys_reboot\n");
+    abort();
+}
+
+uint32_t crc32_ieee(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xffffffffu;
+    for(size_t i = 0; i < len; ++i)
+    {
+        crc ^= data[i];
+        for(int b = 0; b < 8; ++b)
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+int settings_save_one(const char *name, const void *value, size_t val_len)
+{
+    if (st().settings_save_hook)
+    {
+        if (int rc = st().settings_save_hook(name); rc < 0)
+            return rc;
+    }
+    ++st().stats.settings_saves;
+    auto *p = static_cast<const uint8_t*>(value);
+    st().settings[name] = std::vector<uint8_t>(p, p + val_len);
+    return 0;
+}
+
+int settings_delete(const char *name)
+{
+    ++st().stats.settings_deletes;
+    st().settings.erase(name);
+    return 0;
+}
+
+//Zephyr semantics: 'name' matches 'key' if equal, or if 'key' is followed by '/' in 'name' ('next' then points past it)
+int settings_name_steq(const char *name, const char *key, const char **next)
+{
+    if (next)
+        *next = nullptr;
+    if (!name || !key)
+        return 0;
+    while(*key && *name && *name == *key && *name != '=')
+    {
+        ++key;
+        ++name;
+    }
+    if (*key)
+        return 0;
+    if (*name == '/')
+    {
+        if (next)
+            *next = name + 1;
+        return 1;
+    }
+    return *name == '=' || *name == '\0';
+}
+
+int adc_sequence_init_dt(const struct adc_dt_spec *, struct adc_sequence *seq)
+{
+    //like Zephyr: only the channel configuration is filled in, buffer and options are the caller's
+    seq->channels = 1;
+    seq->resolution = 12;
+    seq->oversampling = 0;
+    return 0;
+}
+
+int adc_read_dt(const struct adc_dt_spec *, const struct adc_sequence *seq)
+{
+    size_t n = seq->buffer_size / sizeof(uint16_t);
+    for(size_t i = 0; i < n; ++i)
+        static_cast<uint16_t*>(seq->buffer)[i] = uint16_t(st().adc_raw);
+    return 0;
+}
+
+int adc_raw_to_millivolts_dt(const struct adc_dt_spec *, int32_t *) { return 0; }
+bool adc_is_ready_dt(const struct adc_dt_spec *) { return true; }
+int adc_channel_setup_dt(const struct adc_dt_spec *) { return 0; }
+
+int regulator_enable(const struct device *)
+{
+    ++st().stats.regulator_on;
+    ++st().regulators;
+    return 0;
+}
+
+int regulator_disable(const struct device *)
+{
+    --st().regulators;
+    return 0;
+}
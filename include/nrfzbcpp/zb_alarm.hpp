@@ -1,195 +1,212 @@
 #ifndef ZBH_ALARM_HPP_
 #define ZBH_ALARM_HPP_
 
-#include <optional>
-#include <zephyr/sys/reboot.h>
 #include <cstdint>
 #include <lib_function.hpp>
 #include <lib_misc_helpers.hpp>
-#include <nrf_general/libz_thread_lock.hpp>
+#include <atomic>
+#include <zephyr/kernel.h>
 #include "zboss_api_core.h"
+#include <zb_nrf_platform.h>
+#include "zb_timer_wheel.hpp"
 
 
 namespace zb
 {
-    using ALARM_LIST_LOCK_TYPE = thread::SpinLock;
-    struct zb_alarm_t
+    //All zb_alarm_t/zb_timer_t objects are multiplexed onto a single ZBOSS alarm through the timer wheel.
+    //There's no limit on the amount of armed timers: the alarm object itself is the wheel node.
+    //
+    //The wheel is owned by the ZBOSS thread and takes no locks. Setup/Cancel called from any other thread
+    //are handed over as requests: a request slot comes from a lock-free free-list, gets pushed onto
+    //a lock-free pending list and the ZBOSS thread applies the pending requests in order.
+    struct zb_alarm_t: protected timer_node_t
     {
-        static constexpr uint8_t kCounterOfDeathInactive = 0xff;
-        static constexpr uint8_t kCounterOfDeathValue = 6;
-        static constexpr uint8_t kLowOnHandlesThreshold = 2;
-
-        static bool g_RunningOutOfHandles;
-        static uint8_t g_CounterOfDeath;
-
-        struct timer_list_t
+        struct zboss_clock_t
         {
-            static constexpr uint8_t kFull = 9;
-            static constexpr uint8_t kMaxSize = kFull - 1;
-
-            using handle_t = uint8_t;
-            static constexpr handle_t kInvalidHandle = kFull;
-
-            struct timer_entry_t
+            static tick_t now() { return ZB_TIMER_GET(); }
+            static bool schedule(tick_t delay)
             {
-                zb_alarm_t *pAlarm;
-                void* cb;
-                void *param;
-            };
-
-            struct handle_entry_t
-            {
-                timer_entry_t &entry;
-                handle_t h;
-            };
-
-            std::optional<handle_entry_t> Allocate()
-            {
-                thread::LockGuard l(&g_AlarmLock);
-                if (head != kFull)
-                {
-                    auto r = head;
-                    head = entries[head].nextFree;
-                    return handle_entry_t{entries[r].entry, r};
-                }
-                return std::nullopt;
-            }
-
-            void Free(handle_t h)
-            {
-                thread::LockGuard l(&g_AlarmLock);
-                entries[h].nextFree = head;
-                head = h;
-            }
-
-            auto& GetEntry(handle_t h) { return entries[h].entry; }
-
-            static constexpr timer_list_t Create()
-            {
-                timer_list_t r;
-                r.head = 0;
-                for(size_t i = 0; i < kMaxSize; ++i)
-                {
-                    auto &e = r.entries[i];
-                    e.nextFree = i + 1;
-                }
-                r.entries[kMaxSize - 1].nextFree = kFull;
-                return r;
+                zb_schedule_alarm_cancel(on_wheel_alarm, 0, nullptr);
+                return zb_schedule_app_alarm(on_wheel_alarm, 0, delay) == RET_OK;
             }
+        };
 
-        private:
+        using wheel_t = timer_wheel_t<zboss_clock_t>;
+        constinit static wheel_t g_Wheel;
 
-            union list_entry_t
-            {
-                uint8_t nextFree;
-                timer_entry_t entry;
-            };
-            handle_t head;
-            list_entry_t entries[kMaxSize];
+        //amount of Setup/Cancel from other threads that may be in flight at once
+        static constexpr uint16_t kMaxForeignRequests = 8;
 
-            static ALARM_LIST_LOCK_TYPE g_AlarmLock;
+        struct request_t
+        {
+            zb_alarm_t *pAlarm;
+            void *cb;
+            void *param;
+            handler_t handler;
+            tick_t expires;
+            bool arm;
         };
-        constinit static timer_list_t g_TimerList;
-
-        using callback_t = void(*)(void*);
-
-        static void on_alarm(timer_list_t::timer_entry_t const& e)
+        using request_stack_t = index_stack_t<kMaxForeignRequests>;
+        constinit static request_t g_Requests[kMaxForeignRequests];
+        constinit static request_stack_t g_FreeRequests;
+        constinit static request_stack_t g_PendingRequests;
+        constinit static std::atomic<k_tid_t> g_ZbThread;
+        constinit static std::atomic<bool> g_WakeupPending;//an on_requests callback is scheduled
+
+        //Call once on the thread that sets the device up, before zigbee_enable(): alarms armed during boot
+        //then go straight to the wheel instead of using up the request slots (nothing would apply them yet).
+        //That thread must leave alarms alone after zigbee_enable(): the ZBOSS thread takes the wheel over
+        //with its first wheel alarm or request callback.
+        static void init() { g_ZbThread.store(k_current_get(), std::memory_order_relaxed); }
+
+        static bool in_zb_thread() { return g_ZbThread.load(std::memory_order_relaxed) == k_current_get(); }
+
+        static void apply_requests()
         {
-            ((callback_t)e.cb)(e.param);
+            g_ZbThread.store(k_current_get(), std::memory_order_relaxed);
+            g_PendingRequests.pop_all_fifo([](uint16_t i){
+                    request_t r = g_Requests[i];
+                    g_FreeRequests.push(i);
+                    if (r.pAlarm->apply(r) != RET_OK)
+                    {
+                        FMT_PRINT("Alarm {}: could not schedule the wheel alarm\n", r.pAlarm->pDescr ? r.pAlarm->pDescr : "");
+                    }
+                    r.pAlarm->m_Requests.fetch_sub(1, std::memory_order_release);
+            });
         }
 
-        template<auto CB = zb_alarm_t::on_alarm>
-        static void on_scheduled_alarm(uint8_t param)
+        static void on_requests(uint8_t)
         {
-            auto e = g_TimerList.GetEntry(param);
-            g_TimerList.Free(e.pAlarm->h);
-            e.pAlarm->h = timer_list_t::kInvalidHandle;
-            CB(e);
+            //cleared first: a request pushed from now on schedules a new callback
+            g_WakeupPending.store(false);
+            apply_requests();
+        }
+        static void on_wheel_alarm(uint8_t)
+        {
+            apply_requests();
+            g_Wheel.run(zboss_clock_t::now());
         }
 
-        const char *pDescr = nullptr;
-        timer_list_t::handle_t h = timer_list_t::kInvalidHandle;
+        using callback_t = void(*)(void*);
 
-        ~zb_alarm_t() { Cancel(); }
+        static void on_alarm(timer_node_t &n)
+        {
+            auto &a = static_cast<zb_alarm_t&>(n);
+            ((callback_t)a.m_Cb)(a.m_Param);
+        }
 
-        bool IsRunning() const { return h != timer_list_t::kInvalidHandle; }
-        void Cancel() { Cancel<on_alarm>(); }
-        zb_ret_t Setup(callback_t cb, void *param, uint32_t time) { return Setup<callback_t, on_alarm>(cb, param, time); }
+        const char *pDescr = nullptr;
 
-    protected:
+        constexpr zb_alarm_t() = default;
+        zb_alarm_t(zb_alarm_t const&) = delete;
+        zb_alarm_t& operator=(zb_alarm_t const&) = delete;
+        //Destroy on the ZBOSS thread: the wheel takes no locks. Another thread may only destroy an alarm
+        //that is not armed. Either way no Setup/Cancel request for it may be in flight
+        ~zb_alarm_t()
+        {
+            ZB_ASSERT(m_Requests.load(std::memory_order_acquire) == 0);
+            if (in_zb_thread())
+                g_Wheel.cancel(*this);
+            else
+                ZB_ASSERT(!IsArmed());
+        }
 
-        template<auto CB>
+        bool IsRunning() const { return IsArmed(); }
+        //The alarm may fire up to 'ms' late. Alarms with overlapping windows are coalesced into one wakeup.
+        //Takes effect on the next Setup.
+        void SetSlack(uint32_t ms) { m_Slack = ZB_MILLISECONDS_TO_BEACON_INTERVAL(ms); }
         void Cancel()
         {
-            if (IsRunning())
+            if (in_zb_thread())
+                g_Wheel.cancel(*this);
+            else if (post_request({.pAlarm = this, .arm = false}) != RET_OK)
             {
-                zb_schedule_alarm_cancel(on_scheduled_alarm<CB>, h, nullptr);
-                g_TimerList.Free(h);
-                h = timer_list_t::kInvalidHandle;
+                FMT_PRINT("Alarm {}: could not post a cancel request\n", pDescr ? pDescr : "");
             }
         }
+        zb_ret_t Setup(callback_t cb, void *param, uint32_t time) { return Setup<callback_t, on_alarm>(cb, param, time); }
 
-        template<class callback_t, auto CB>
+    protected:
+        void *m_Cb = nullptr;
+        void *m_Param = nullptr;
+        std::atomic<uint8_t> m_Requests{0};//posted by other threads, not applied yet
+
+        template<class callback_t, handler_t CB>
         zb_ret_t Setup(callback_t cb, void *param, uint32_t time)
         {
-            Cancel<CB>();
-            if (auto r = g_TimerList.Allocate())
-            {
-                auto &v = *r;
-                h = v.h;
-                static_assert(sizeof(void*) == sizeof(callback_t));
-                v.entry.cb = (void*)cb;
-                v.entry.param = param;
-                v.entry.pAlarm = this;
-
-                if (h >= kLowOnHandlesThreshold)
-                {
-                    FMT_PRINT("Got back handle {:x} >= threshold of {:x}. Prepare to die\n", h, kLowOnHandlesThreshold);
-                    //soon we'll be out of handles - let's restart at a convenient moment
-                    g_RunningOutOfHandles = true;
-                }
-                return zb_schedule_app_alarm(on_scheduled_alarm<CB>, h, ZB_MILLISECONDS_TO_BEACON_INTERVAL(time));
-            }else
-                return RET_NO_MEMORY;
+            return SetupAt<callback_t, CB>(cb, param, zboss_clock_t::now() + ZB_MILLISECONDS_TO_BEACON_INTERVAL(time));
         }
 
-    public:
-        static void deactivate_counter_of_death()
+        template<class callback_t, handler_t CB>
+        zb_ret_t SetupAt(callback_t cb, void *param, tick_t expires)
         {
-            FMT_PRINT("Low on handles: Counter of death deactivated\n");
-            g_CounterOfDeath = kCounterOfDeathInactive;
+            static_assert(sizeof(void*) == sizeof(callback_t));
+            request_t r{.pAlarm = this, .cb = (void*)cb, .param = param, .handler = CB, .expires = expires, .arm = true};
+            if (!in_zb_thread())
+                return post_request(r);
+            return apply(r);
         }
 
-        static void check_counter_of_death()
+        //RET_ERROR if the ZBOSS alarm behind the wheel could not be scheduled: the alarm stays disarmed
+        zb_ret_t apply(request_t const& r)
         {
-            if (g_RunningOutOfHandles)
-            {
-                g_CounterOfDeath = kCounterOfDeathValue;
-                FMT_PRINT("Low on handles: Counter of death activated: {} iterations left\n", g_CounterOfDeath);
-            }
+            g_Wheel.cancel(*this);
+            if (!r.arm)
+                return RET_OK;
+            m_Cb = r.cb;
+            m_Param = r.param;
+            m_Handler = r.handler;
+            return g_Wheel.arm(*this, r.expires) ? RET_OK : RET_ERROR;
         }
 
-        static void check_death_count()
+        static zb_ret_t post_request(request_t const& r)
         {
-            if (g_RunningOutOfHandles && g_CounterOfDeath != kCounterOfDeathInactive)
+            auto i = g_FreeRequests.pop();
+            if (!i)
             {
-                if (!(--g_CounterOfDeath))
-                {
-                    //boom
-                    FMT_PRINT("Low on handles: time to die and reborn\n");
-
-                    sys_reboot(SYS_REBOOT_WARM);
-                    return;
-                }
-                FMT_PRINT("Low on handles: tick-tock: {} iterations left\n", zb_alarm_t::g_CounterOfDeath);
+                //all slots are pending: their wake-up may have failed, nothing else would retry it
+                wake_zb_thread();
+                return RET_NO_MEMORY;
             }
+            r.pAlarm->m_Requests.fetch_add(1, std::memory_order_relaxed);
+            g_Requests[*i] = r;
+            g_PendingRequests.push(*i);
+            return wake_zb_thread();
+        }
+
+        //one scheduled callback applies everything pending. If it can't be scheduled, the next request
+        //tries again (and a wheel alarm applies pending requests too): queued requests stay queued either way
+        static zb_ret_t wake_zb_thread()
+        {
+            if (g_WakeupPending.exchange(true))
+                return RET_OK;
+            zb_ret_t res = zigbee_schedule_callback(on_requests, 0);
+            if (res != RET_OK)
+                g_WakeupPending.store(false);
+            return res;
         }
+
+    public:
+        //Handles can't run out anymore. Kept for API compatibility, do nothing.
+        static void deactivate_counter_of_death() {}
+        static void check_counter_of_death() {}
+        static void check_death_count() {}
     };
 
-    inline bool zb_alarm_t::g_RunningOutOfHandles = false;
-    inline uint8_t zb_alarm_t::g_CounterOfDeath = kCounterOfDeathInactive;
-    inline ALARM_LIST_LOCK_TYPE zb_alarm_t::timer_list_t::g_AlarmLock;
-    inline constinit zb_alarm_t::timer_list_t zb_alarm_t::g_TimerList = zb_alarm_t::timer_list_t::Create();
+    inline constinit zb_alarm_t::wheel_t zb_alarm_t::g_Wheel;
+    inline constinit zb_alarm_t::request_t zb_alarm_t::g_Requests[kMaxForeignRequests] = {};
+    inline constinit zb_alarm_t::request_stack_t zb_alarm_t::g_FreeRequests{request_stack_t::full_t{}};
+    inline constinit zb_alarm_t::request_stack_t zb_alarm_t::g_PendingRequests;
+    inline constinit std::atomic<k_tid_t> zb_alarm_t::g_ZbThread{nullptr};
+    inline constinit std::atomic<bool> zb_alarm_t::g_WakeupPending{false};
+
+    enum class timer_mode_t: uint8_t
+    {
+        //next period starts when the callback returns: callback runtime and latency add up as drift
+        Relative,
+        //periods are counted from the first deadline; missed periods are skipped
+        Absolute,
+    };
 
     struct zb_timer_t: zb_alarm_t
     {
@@ -197,16 +214,19 @@ namespace zb
         using callback_t = bool (*)(void* param);
 
         uint32_t m_Interval = 0;
+        timer_mode_t m_Mode = timer_mode_t::Relative;
 
-        ~zb_timer_t() { Cancel(); }
-
-        static void on_timer(timer_list_t::timer_entry_t const& e)
+        static void on_timer(timer_node_t &n)
         {
-            if (callback_t(e.cb)(e.param))
+            auto &t = static_cast<zb_timer_t&>(static_cast<zb_alarm_t&>(n));
+            if (callback_t(t.m_Cb)(t.m_Param))
             {
-                zb_timer_t *pT = static_cast<zb_timer_t*>(e.pAlarm);
                 //re-schedule
-                auto res = pT->Setup(callback_t(e.cb), e.param, pT->m_Interval);
+                zb_ret_t res;
+                if (t.m_Mode == timer_mode_t::Absolute)
+                    res = t.SetupAt<callback_t, on_timer>(callback_t(t.m_Cb), t.m_Param, t.next_deadline());
+                else
+                    res = t.Setup(callback_t(t.m_Cb), t.m_Param, t.m_Interval);
                 if (res != RET_OK)
                 {
                     FMT_PRINT("Could not re-register timer with error {:x}\n", res);
@@ -214,13 +234,26 @@ namespace zb
             }
         }
 
-        void Cancel() { zb_alarm_t::Cancel<on_timer>(); }
-
-        zb_ret_t Setup(callback_t cb, void *param, uint32_t time)
+        zb_ret_t Setup(callback_t cb, void *param, uint32_t time, timer_mode_t mode = timer_mode_t::Relative)
         {
             m_Interval = time;
+            m_Mode = mode;
             return zb_alarm_t::Setup<callback_t, on_timer>(cb, param, time);
         }
+
+    private:
+        //the first period boundary after now, counted from the previous deadline rather than from when it fired
+        tick_t next_deadline() const
+        {
+            tick_t period = ZB_MILLISECONDS_TO_BEACON_INTERVAL(m_Interval);
+            if (!period)
+                period = 1;
+            tick_t next = m_Expires + period;
+            tick_t late = zboss_clock_t::now() - next;
+            if (int32_t(late) >= 0)
+                next += (late / period + 1) * period;
+            return next;
+        }
     };
 
     template<size_t FuncSZ = 16>
@@ -232,10 +265,10 @@ namespace zb
         static bool on_timer_ext(void *param) { return (*(generic_callback_t*)param)(); }
 
         template<class callback_t>
-        zb_ret_t Setup(callback_t &&cb, uint32_t time)
+        zb_ret_t Setup(callback_t &&cb, uint32_t time, timer_mode_t mode = timer_mode_t::Relative)
         {
             m_Callback = std::forward<callback_t>(cb);
-            return zb_timer_t::Setup(on_timer_ext, &m_Callback, time);
+            return zb_timer_t::Setup(on_timer_ext, &m_Callback, time, mode);
         }
     };
     using zb_timer_ext_16_t = zb_timer_ext_t<16>;
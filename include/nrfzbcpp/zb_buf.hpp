@@ -3,6 +3,9 @@
 
 #include "zb_types.hpp"
 #include <utility>
+#include <algorithm>
+#include <array>
+#include <bit>
 
 namespace zb
 {
@@ -44,7 +47,7 @@ namespace zb
     };
 
 
-    //this is expected to be in small numbers
+    //slot bitmap: allocate/deallocate are a count-trailing-zeros per 32 slots
     template<size_t N>
     struct pre_alloc_zb_bufs_out
     {
@@ -55,27 +58,35 @@ namespace zb
             {
                 if ((bufs[i] = zb_buf_get_out()) == ZB_BUF_INVALID)
                     return int(N - i);
+                set(i);
             }
             return 0;
         }
 
         zb_bufid_t allocate()
         {
-            for(size_t i = 0; i < N; ++i)
+            for(size_t w = 0; w < kWords; ++w)
             {
-                if (bufs[i] != ZB_BUF_INVALID)
+                if (uint32_t m = avail[w])
+                {
+                    size_t i = w * 32 + std::countr_zero(m);
+                    avail[w] = m & (m - 1);
+                    --count;
                     return std::exchange(bufs[i], ZB_BUF_INVALID);
+                }
             }
             return ZB_BUF_INVALID;
         }
 
         void deallocate(zb_bufid_t buf)
         {
-            for(size_t i = 0; i < N; ++i)
+            for(size_t w = 0; w < kWords; ++w)
             {
-                if (bufs[i] == ZB_BUF_INVALID)
+                if (uint32_t m = ~avail[w] & word_mask(w))
                 {
+                    size_t i = w * 32 + std::countr_zero(m);
                     bufs[i] = buf;
+                    set(i);
                     zb_buf_reuse(buf);
                     return;
                 }
@@ -94,10 +105,125 @@ namespace zb
                     bufs[i] = ZB_BUF_INVALID;
                 }
             }
+            avail = {};
+            count = 0;
         }
+
+        //amount of buffers that can be allocated right now
+        size_t available() const { return count; }
     private:
-        zb_bufid_t bufs[N]{};
+        static constexpr size_t kWords = (N + 31) / 32;
+        static constexpr uint32_t word_mask(size_t w) { return (w + 1) * 32 <= N ? uint32_t(-1) : (uint32_t(1) << (N % 32)) - 1; }
+
+        void set(size_t i)
+        {
+            avail[i / 32] |= uint32_t(1) << (i % 32);
+            ++count;
+        }
+
+        std::array<zb_bufid_t, N> bufs{};//N may be 0 (auto-sized EP without generated commands)
+        std::array<uint32_t, kWords> avail{};//bit set - bufs[i] holds a buffer
+        size_t count = 0;
+    };
+
+    //handle to a client's share of a shared_zb_bufs_out pool, has the same interface as pre_alloc_zb_bufs_out
+    struct shared_zb_bufs_ref_t
+    {
+        struct ops_t
+        {
+            zb_bufid_t (*allocate)(void *pool, uint8_t client);
+            void (*deallocate)(void *pool, uint8_t client, zb_bufid_t buf);
+            size_t (*available)(const void *pool, uint8_t client);
+            void (*drain)(void *pool);
+        };
+
+        //the owner of the pool allocates the buffers
+        int init() { return 0; }
+        zb_bufid_t allocate() { return ops ? ops->allocate(pool, client) : ZB_BUF_INVALID; }
+        void deallocate(zb_bufid_t buf) { ops->deallocate(pool, client, buf); }
+        size_t available() const { return ops ? ops->available(pool, client) : 0; }
+        //a buffer came back: let every client of the pool send what it has queued
+        void drain() { if (ops) ops->drain(pool); }
+
+        const ops_t *ops = nullptr;
+        void *pool = nullptr;
+        uint8_t client = 0;
+    };
+
+    //N buffers shared by several clients (EPs). A client can't hold more than its cap and
+    //can always get its reserved amount: buffers others haven't reserved are first come, first served
+    template<size_t N, size_t Clients>
+    struct shared_zb_bufs_out
+    {
+        using drain_func_t = void(*)();
+
+        int init() { return bufs.init(); }
+
+        shared_zb_bufs_ref_t attach(uint8_t c, uint8_t reserved, uint8_t cap, drain_func_t drain)
+        {
+            ZB_ASSERT(c < Clients);
+            clients[c] = {.drain = drain, .reserved = reserved, .cap = cap, .used = 0};
+            unused_reserve += reserved;
+            return {.ops = &kOps, .pool = this, .client = c};
+        }
+
+        //amount of buffers client c can allocate right now
+        size_t available(uint8_t c) const
+        {
+            const client_t &cl = clients[c];
+            if (cl.used >= cl.cap)
+                return 0;
+            size_t own = cl.used < cl.reserved ? cl.reserved - cl.used : 0;
+            size_t others = unused_reserve - own;
+            size_t total = bufs.available();
+            return std::min<size_t>(total > others ? total - others : 0, cl.cap - cl.used);
+        }
+
+        zb_bufid_t allocate(uint8_t c)
+        {
+            if (!available(c))
+                return ZB_BUF_INVALID;
+            client_t &cl = clients[c];
+            if (cl.used++ < cl.reserved)
+                --unused_reserve;
+            return bufs.allocate();
+        }
+
+        void deallocate(uint8_t c, zb_bufid_t buf)
+        {
+            client_t &cl = clients[c];
+            ZB_ASSERT(cl.used);
+            if (--cl.used < cl.reserved)
+                ++unused_reserve;
+            bufs.deallocate(buf);
+        }
+
+        void drain()
+        {
+            for(client_t &cl : clients)
+                if (cl.drain) cl.drain();
+        }
+
+        //amount of buffers not allocated by anyone
+        size_t available() const { return bufs.available(); }
+    private:
+        struct client_t
+        {
+            drain_func_t drain = nullptr;
+            uint8_t reserved = 0;
+            uint8_t cap = 0;
+            uint8_t used = 0;
+        };
+
+        static zb_bufid_t allocate_op(void *p, uint8_t c) { return static_cast<shared_zb_bufs_out*>(p)->allocate(c); }
+        static void deallocate_op(void *p, uint8_t c, zb_bufid_t buf) { static_cast<shared_zb_bufs_out*>(p)->deallocate(c, buf); }
+        static size_t available_op(const void *p, uint8_t c) { return static_cast<const shared_zb_bufs_out*>(p)->available(c); }
+        static void drain_op(void *p) { static_cast<shared_zb_bufs_out*>(p)->drain(); }
+        static constexpr shared_zb_bufs_ref_t::ops_t kOps{&allocate_op, &deallocate_op, &available_op, &drain_op};
+
+        pre_alloc_zb_bufs_out<N> bufs;
+        std::array<client_t, Clients> clients{};
+        size_t unused_reserve = 0;//reserved by clients, but not allocated yet
     };
 }
 #endif
-
@@ -0,0 +1,92 @@
+#ifndef ZBH_CORO_HPP_
+#define ZBH_CORO_HPP_
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <bit>
+#include "zb_alarm.hpp"
+
+namespace zb
+{
+    //Fixed pool of equally sized coroutine frames. Coroutines are resumed on the ZBOSS thread only, so no locking.
+    template<size_t FrameSize, size_t Frames>
+    struct coro_frame_arena_t
+    {
+        static_assert(Frames > 0 && Frames <= 32, "up to 32 frames per arena");
+        static constexpr uint32_t kAllFree = Frames == 32 ? uint32_t(-1) : ((uint32_t(1) << Frames) - 1);
+        //every frame has to start max_align_t aligned, not only the first one
+        static constexpr size_t kFrameSize = (FrameSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+        void* allocate(size_t sz)
+        {
+            if (sz > kFrameSize || !m_Free)
+            {
+                FMT_PRINT("coro arena: can't allocate a frame of {} bytes (frame size: {}, free: {})\n", sz, kFrameSize, std::popcount(m_Free));
+                return nullptr;
+            }
+            uint8_t i = std::countr_zero(m_Free);
+            m_Free &= ~(uint32_t(1) << i);
+            return m_Frames[i];
+        }
+
+        void deallocate(void *p)
+        {
+            size_t i = (static_cast<std::byte*>(p) - &m_Frames[0][0]) / kFrameSize;
+            ZB_ASSERT(i < Frames);
+            m_Free |= uint32_t(1) << i;
+        }
+
+        size_t in_use() const { return Frames - std::popcount(m_Free); }
+
+    private:
+        uint32_t m_Free = kAllFree;
+        alignas(std::max_align_t) std::byte m_Frames[Frames][kFrameSize] = {};
+    };
+
+    //Fire-and-forget coroutine: starts right away, the frame is released when it finishes.
+    //Frames come from a static arena per FrameSize/Frames pair, no heap is used.
+    //If the frame doesn't fit or the arena is exhausted the coroutine doesn't start (see started()).
+    template<size_t FrameSize = 256, size_t Frames = 2>
+    struct basic_task_t
+    {
+        using arena_t = coro_frame_arena_t<FrameSize, Frames>;
+        inline static constinit arena_t g_Arena{};
+
+        struct promise_type
+        {
+            static void* operator new(size_t sz) noexcept { return g_Arena.allocate(sz); }
+            static void operator delete(void *p) noexcept { g_Arena.deallocate(p); }
+            static basic_task_t get_return_object_on_allocation_failure() noexcept { return {false}; }
+
+            basic_task_t get_return_object() noexcept { return {true}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept {}
+        };
+
+        bool started() const { return m_Started; }
+
+        bool m_Started = false;
+    };
+    using task_t = basic_task_t<>;
+
+    //co_await zb::sleep_ms(50); - suspends the coroutine on a zb_alarm_t living in its frame
+    struct sleep_awaiter_t
+    {
+        uint32_t m_Ms;
+        zb_alarm_t m_Alarm;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            //resumes right away if the alarm could not be armed
+            return m_Alarm.Setup([](void *p){ std::coroutine_handle<>::from_address(p).resume(); }, h.address(), m_Ms) == RET_OK;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    inline sleep_awaiter_t sleep_ms(uint32_t ms) { return sleep_awaiter_t{ms}; }
+}
+#endif
@@ -4,8 +4,21 @@
 #include "zb_desc_helper_types.hpp"
 #include "zb_desc_helper_types_cmd_handling.hpp"
 
+//When set to 1 the received/generated command id lists of each cluster type are emitted once as constexpr data (flash)
+//instead of being a part of each attribute list. Only the id bytes move: the revision, the ZBOSS command list descriptor
+//and the zb_zcl_attr_t array stay in RAM.
+//See also NRFZBCPP_CMD_LISTS_IN_FLASH option in CMakeLists.txt (NRFZBCPP_METADATA_IN_FLASH is the old name)
+#if !defined(NRFZBCPP_CMD_LISTS_IN_FLASH) && defined(NRFZBCPP_METADATA_IN_FLASH)
+#define NRFZBCPP_CMD_LISTS_IN_FLASH NRFZBCPP_METADATA_IN_FLASH
+#endif
+#ifndef NRFZBCPP_CMD_LISTS_IN_FLASH
+#define NRFZBCPP_CMD_LISTS_IN_FLASH 0
+#endif
+
 namespace zb
 {
+    inline constexpr bool kCmdListsInFlash = NRFZBCPP_CMD_LISTS_IN_FLASH;
+
     inline constexpr zb_zcl_attr_t g_LastAttribute{
         .id = ZB_ZCL_NULL_ID,
         .type = ZB_ZCL_ATTR_TYPE_NULL,
@@ -39,7 +52,7 @@ namespace zb
     template<size_t N>
     struct cmd_id_list_t
     {
-        [[no_unique_address]]uint8_t cmds[N];
+        [[no_unique_address]]std::array<uint8_t, N> cmds;//no zero-length array with N == 0
     };
 
     template<class StructTag, size_t N>
@@ -47,6 +60,37 @@ namespace zb
     {
         using Tag = decltype(zcl_description_t<StructTag>::get());
 
+        //instance-independent metadata kept in RAM along with the attribute list
+        struct ram_metadata_t
+        {
+            zb_uint16_t rev = Tag::info().rev;
+            [[no_unique_address]]cmd_id_list_t<Tag::count_received()> received_commands = Tag::get_received_commands();
+            [[no_unique_address]]cmd_id_list_t<Tag::count_generated()> generated_commands = Tag::get_generated_commands();
+
+            zb_discover_cmd_list_t cmd_list =
+            {
+              Tag::count_received(), received_commands.cmds.data(),
+              Tag::count_generated(), generated_commands.cmds.data()
+            };
+        };
+
+        //command id lists as constexpr data. The revision and zb_discover_cmd_list_t stay in RAM: ZBOSS takes
+        //both through non-const pointers. The id lists are taken the same way, but ZBOSS only ever reads them
+        struct flash_cmd_lists_metadata_t
+        {
+            static constexpr cmd_id_list_t<Tag::count_received()> received_commands = Tag::get_received_commands();
+            static constexpr cmd_id_list_t<Tag::count_generated()> generated_commands = Tag::get_generated_commands();
+
+            zb_uint16_t rev = Tag::info().rev;
+            zb_discover_cmd_list_t cmd_list =
+            {
+              Tag::count_received(), const_cast<zb_uint8_t*>(received_commands.cmds.data()),
+              Tag::count_generated(), const_cast<zb_uint8_t*>(generated_commands.cmds.data())
+            };
+        };
+
+        using metadata_t = std::conditional_t<kCmdListsInFlash, flash_cmd_lists_metadata_t, ram_metadata_t>;
+
         attribute_list_t(attribute_list_t const&) = delete;
         attribute_list_t(attribute_list_t &&) = delete;
         void operator=(attribute_list_t const&) = delete;
@@ -57,13 +101,10 @@ namespace zb
         constexpr attribute_list_t(StructTag *pData, attribute_desc_t<T>... d):
             cluster_struct(pData)
             ,attributes{
-                AttrDesc(zb::attribute_desc_t{ .id = ZB_ZCL_ATTR_GLOBAL_CLUSTER_REVISION_ID, .a = access_t::Read, .pData = &rev }),
+                AttrDesc(zb::attribute_desc_t{ .id = ZB_ZCL_ATTR_GLOBAL_CLUSTER_REVISION_ID, .a = access_t::Read, .pData = &meta.rev }),
                 AttrDesc(d)...
                 , g_LastAttribute
-            },
-            rev(Tag::info().rev),
-            received_commands(Tag::get_received_commands()),
-            generated_commands(Tag::get_generated_commands())
+            }
         {
         }
 
@@ -78,10 +119,20 @@ namespace zb
         }
 
         constexpr operator zb_zcl_attr_t*() { return attributes; }
-        constexpr operator zb_discover_cmd_list_t*() { return &cmd_list; }
+        constexpr operator zb_discover_cmd_list_t*() { return &meta.cmd_list; }
+
+        //RAM the metadata of this cluster takes in the default mode, and the command id bytes kept in flash
+        //with NRFZBCPP_CMD_LISTS_IN_FLASH (0 otherwise)
+        constexpr static size_t metadata_ram_size() { return sizeof(ram_metadata_t); }
+        constexpr static size_t cmd_lists_in_flash() { return kCmdListsInFlash ? Tag::count_received() + Tag::count_generated() : 0; }
+
+        //index of the attribute in 'attributes' (cluster revision always goes first)
+        template<auto memPtr>
+        constexpr static size_t attr_desc_index() { return Tag::template get_member_index<memPtr>() + 1; }
 
         constexpr static auto max_command_pool_size() { return Tag::max_command_pool_size(); }
         constexpr static auto max_command_arg_raw_size() { return Tag::max_command_arg_raw_size(); }
+        constexpr static size_t cmd_queue_demand() { return Tag::cmd_queue_demand(); }
         constexpr static bool is_role(role_t r) { return Tag::info().role == r; }
         constexpr static size_t attributes_with_access(access_t r) { return Tag::count_members_with_access(r); }
         constexpr static size_t cvc_attributes() { return Tag::count_cvc_members(); }
@@ -104,15 +155,7 @@ namespace zb
 
         StructTag *cluster_struct;
         alignas(4) zb_zcl_attr_t attributes[N + 2];
-        zb_uint16_t rev;
-        [[no_unique_address]]cmd_id_list_t<Tag::count_received()> received_commands;
-        [[no_unique_address]]cmd_id_list_t<Tag::count_generated()> generated_commands;
-
-        zb_discover_cmd_list_t cmd_list =
-        {
-          Tag::count_received(), received_commands.cmds,
-          Tag::count_generated(), generated_commands.cmds
-        };
+        metadata_t meta;
     };
 
     template<class ClusterTag, class... T>
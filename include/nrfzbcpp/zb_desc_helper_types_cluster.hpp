@@ -5,8 +5,13 @@
 #include "zb_desc_helper_types_attr.hpp"
 #include "zb_desc_helper_types_cmd_handling.hpp"
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <utility>
 #include <optional>
 #include <span>
+#include <tuple>
 
 namespace zb
 {
@@ -57,6 +62,18 @@ namespace zb
     template<class T, class MemType>
     using mem_attr_t = MemType T::*;
 
+    //default reporting configuration of an attribute installed by generic_cluster_init
+    //(a configuration from a coordinator - Configure Reporting or restored from NVRAM - is never overwritten)
+    //max_interval 0 - keep the ZBOSS intervals (min_interval alone is rejected); all 0 - leave ZBOSS defaults
+    struct report_defaults_t
+    {
+        uint16_t min_interval = 0;//seconds
+        uint16_t max_interval = 0;//seconds
+        uint32_t delta = 0;//reportable change, in attribute units
+
+        constexpr bool is_set() const { return min_interval || max_interval || delta; }
+    };
+
     template<class T, class MemType>
     struct attribute_mem_desc_t
     {
@@ -67,8 +84,12 @@ namespace zb
         access_t a = access_t::Read;
         type_t type = TypeToTypeId<MemType>();
         attr_validator_t validator = ValidatorForType<MemType>();
+        double deadband = 0;//for shadow attributes (ep_desc_t::shadow_attr): changes not bigger than this (in attribute units) are dropped
+                            //double: covers the whole range of every arithmetic attribute type and fractions for float ones
+        report_defaults_t report = {};//only for attributes with access_t::Report
 
         constexpr inline bool has_access(access_t _a) const { return a & _a; } 
+        constexpr inline bool has_report_defaults() const { return has_access(access_t::Report) && report.is_set(); }
         constexpr inline bool has_validator() const { return validator != nullptr; }
         constexpr inline bool is_cvc() const { 
             if (a & access_t::Report)
@@ -181,6 +202,8 @@ namespace zb
     {
         uint8_t raw[N];
 
+        request_runtime_args_raw_t() = default;
+
         template<cmd_arg_c... T>
         request_runtime_args_raw_t(zb_callback_t cb, uint16_t short_a, uint8_t e, addr_mode_t _addr_mode, T const&... args):
             request_runtime_args_base_t{.cb = cb, .dst_addr = {.addr_short = short_a} , .dst_ep = e, .addr_mode = _addr_mode, .canceled = false}
@@ -251,7 +274,7 @@ namespace zb
 
         [[no_unique_address]]conditional_var_t<typed_callback_t, cfg.receive> m_Callback{};
 
-        using cmd_prepare_t = cmd_prepare_t<Args...>;
+        using cmd_prepare_t = zb::cmd_prepare_t<Args...>;
     };
 
     template<zb_uint8_t cmd_id, class... Args>
@@ -294,7 +317,7 @@ namespace zb
             if (data.size() < kArgRawSize) return {RET_ILLEGAL_REQUEST, true};
 
             const uint8_t *pData = data.data();
-            cmd_to_arg_t to_arg{pData};
+            [[maybe_unused]] cmd_to_arg_t to_arg{pData};
             return pThis->cb(to_arg((Args*)nullptr)...);
         }
     };
@@ -327,26 +350,118 @@ namespace zb
     struct cluster_attributes_desc_t
     {
         static_assert(attribute_tools::kAllUniqueIds<attributeMemberDesc...>, "All attribute ids must be unique!");
+        static_assert(((attributeMemberDesc.report.delta == 0 || (std::is_arithmetic_v<typename decltype(attributeMemberDesc)::MemT> && sizeof(typename decltype(attributeMemberDesc)::MemT) <= 4)) && ...),
+                "report.delta is only supported for arithmetic attributes of up to 4 bytes");
+        static_assert(((attributeMemberDesc.report.min_interval == 0 || attributeMemberDesc.report.max_interval != 0) && ...),
+                "report: min_interval needs max_interval too (max_interval 0 would disable periodic reports)");
+        static_assert(((attributeMemberDesc.report.min_interval <= attributeMemberDesc.report.max_interval || attributeMemberDesc.report.max_interval == 0) && ...),
+                "report: min_interval must not exceed max_interval");
         static constexpr inline size_t count_members_with_access(access_t a) { return ((size_t)attributeMemberDesc.has_access(a) + ... + 0); }
         static constexpr inline size_t count_cvc_members() { return ((size_t)attributeMemberDesc.is_cvc() + ... + 0); }
         static constexpr inline size_t count_members_with_validators() { return ((size_t)attributeMemberDesc.has_validator() + ... + 0); }
+        static constexpr inline size_t count_members_with_report_defaults() { return ((size_t)attributeMemberDesc.has_report_defaults() + ... + 0); }
 
         template<auto memPtr>
         static constexpr inline auto get_member_description() { return find_attribute_by_mem_ptr_t<memPtr, attributeMemberDesc...>::mem_desc(); }
 
-        static constexpr attr_validator_t find_attribute_validator(uint16_t id)
+        struct attr_report_defaults_entry_t
         {
-            attr_validator_t res = {};
-            bool keep = false;
-            auto check = [&](auto attrMemDesc){
-                if (attrMemDesc.id == id)
-                {
-                    res = attrMemDesc.validator;
-                    return false;
-                }
-                return true;
+            uint16_t id = 0;
+            uint16_t min_interval = 0;
+            uint16_t max_interval = 0;
+            uint8_t delta_size = 0;
+            std::array<uint8_t, 4> delta{};//already in the attribute's representation
+        };
+
+        template<class MemType>
+        static constexpr std::array<uint8_t, 4> delta_to_raw(uint32_t delta)
+        {
+            std::array<uint8_t, 4> res{};
+            if constexpr (std::is_arithmetic_v<MemType> && sizeof(MemType) <= 4)
+            {
+                auto raw = std::bit_cast<std::array<uint8_t, sizeof(MemType)>>(MemType(delta));
+                for(size_t i = 0; i < raw.size(); ++i)
+                    res[i] = raw[i];
+            }
+            return res;
+        }
+
+        //only attributes that have reporting defaults declared
+        static constexpr auto report_defaults()
+        {
+            std::array<attr_report_defaults_entry_t, count_members_with_report_defaults()> res{};
+            size_t i = 0;
+            auto add = [&]<class MemDesc>(MemDesc attrMemDesc){
+                using MemType = typename MemDesc::MemT;
+                if (attrMemDesc.has_report_defaults())
+                    res[i++] = {
+                        .id = attrMemDesc.id, 
+                        .min_interval = attrMemDesc.report.min_interval, 
+                        .max_interval = attrMemDesc.report.max_interval,
+                        .delta_size = uint8_t(std::is_arithmetic_v<MemType> && sizeof(MemType) <= 4 ? sizeof(MemType) : 0),
+                        .delta = delta_to_raw<MemType>(attrMemDesc.report.delta)
+                    };
             };
-            (check(attributeMemberDesc) && ...);
+            (add(attributeMemberDesc),...);
+            return res;
+        }
+
+        struct attr_validator_entry_t
+        {
+            uint16_t id = 0;
+            attr_validator_t validator = nullptr;
+        };
+
+        //only attributes that actually have validators, sorted by id
+        static constexpr auto make_validator_table()
+        {
+            std::array<attr_validator_entry_t, count_members_with_validators()> res{};
+            size_t i = 0;
+            [[maybe_unused]] auto add = [&](auto attrMemDesc){
+                if (attrMemDesc.has_validator())
+                    res[i++] = {.id = attrMemDesc.id, .validator = attrMemDesc.validator};
+            };
+            (add(attributeMemberDesc),...);
+            std::sort(res.begin(), res.end(), [](auto const& l, auto const& r){ return l.id < r.id; });
+            return res;
+        }
+
+        static constexpr auto kValidators = make_validator_table();
+
+        static constexpr attr_validator_t find_attribute_validator(uint16_t id)
+        {
+            if constexpr (count_members_with_validators() == 0)
+                return {};
+            else
+            {
+                auto i = std::lower_bound(kValidators.begin(), kValidators.end(), id, [](auto const& e, uint16_t id){ return e.id < id; });
+                if (i != kValidators.end() && i->id == id)
+                    return i->validator;
+                return {};
+            }
+        }
+
+        //position of the attribute in the declaration order (== order of attributes in attribute_list_t after the revision)
+        static constexpr size_t index_of_attribute(uint16_t id)
+        {
+            size_t res = 0;
+            ((attributeMemberDesc.id != id && ++res) && ...);
+            return res;
+        }
+
+        //position of the attribute among reportable attributes of the cluster
+        static constexpr size_t reportable_index_of(uint16_t id)
+        {
+            size_t res = 0;
+            ((attributeMemberDesc.id != id && (res += attributeMemberDesc.has_access(access_t::Report), true)) && ...);
+            return res;
+        }
+
+        static constexpr auto reportable_attribute_ids()
+        {
+            std::array<uint16_t, count_members_with_access(access_t::Report)> res{};
+            size_t i = 0;
+            ((attributeMemberDesc.has_access(access_t::Report) && (res[i++] = attributeMemberDesc.id, true)), ...);
             return res;
         }
 
@@ -370,30 +485,11 @@ namespace zb
         static constexpr inline size_t count_generated() { return ((size_t)mem_ptr_traits<decltype(cmdMemberDesc)>::MemberType::is_generated() + ... + 0); }
         static constexpr inline size_t count_received() { return ((size_t)mem_ptr_traits<decltype(cmdMemberDesc)>::MemberType::is_received() + ... + 0); }
 
-        static constexpr raw_handler_result_t find_cmd_handler(uint8_t id, auto *pStruct)
-        {
-            raw_handler_result_t res;
-            bool found = false;
-            auto check = [&]<class CmdType>(CmdType *pF){
-                if constexpr (CmdType::is_received())
-                {
-                    if (!found && pF->kCmdId == id)
-                    {
-                        res.field = pF;
-                        res.h = &pF->raw_handler;
-                        found = true;
-                    }
-                }
-            };
-            (check(&(pStruct->*cmdMemberDesc)),...);
-            return res;
-        }
-
         static constexpr inline auto get_generated_commands()
         {
             cmd_id_list_t<count_generated()> res;
             int i = 0;
-            auto add = [&](bool is_gen, uint8_t id){
+            [[maybe_unused]] auto add = [&](bool is_gen, uint8_t id){
                 if (is_gen)
                     res.cmds[i++] = id;
             };
@@ -405,7 +501,7 @@ namespace zb
         {
             cmd_id_list_t<count_received()> res;
             int i = 0;
-            auto add = [&](bool is_recv, uint8_t id){
+            [[maybe_unused]] auto add = [&](bool is_recv, uint8_t id){
                 if (is_recv)
                     res.cmds[i++] = id;
             };
@@ -413,6 +509,16 @@ namespace zb
             return res;
         }
 
+        //pre-allocated buffers this cluster asks for with cmd_queue_depth == 0 (auto):
+        //one per generated command, two for commands with a declared timeout
+        //(those keep their buffer until the confirmation arrives, so the next send shouldn't wait for it)
+        static constexpr inline size_t cmd_queue_demand()
+        {
+            return ((mem_ptr_traits<decltype(cmdMemberDesc)>::MemberType::is_generated() 
+                        ? (mem_ptr_traits<decltype(cmdMemberDesc)>::MemberType::timeout_ms() ? size_t(2) : size_t(1)) 
+                        : size_t(0)) + ... + 0);
+        }
+
         static constexpr inline auto max_command_arg_raw_size() 
         { 
             if constexpr (kCmdCount >= 2)
@@ -423,6 +529,71 @@ namespace zb
                 return 0;
         }
 
+        template<class StructT, auto memPtr>
+        static void* cmd_field_getter(void *pStruct) { return &(((StructT*)pStruct)->*memPtr); }
+
+        struct cmd_dispatch_entry_t
+        {
+            uint8_t id = 0;
+            cmd_field_raw_handler_t h = nullptr;
+            void* (*field)(void *pStruct) = nullptr;
+        };
+
+        //smallest modulus for which 'id % M' maps all received command ids to distinct slots
+        //M == 256 is the trivial dense table and always works for 8-bit ids
+        static constexpr size_t received_cmd_hash_modulus()
+        {
+            constexpr auto ids = get_received_commands();
+            for(size_t M = std::max(count_received(), size_t(1)); M < 256; ++M)
+            {
+                bool used[256] = {};
+                bool collision = false;
+                for(uint8_t id : ids.cmds)
+                {
+                    if (std::exchange(used[id % M], true))
+                    {
+                        collision = true;
+                        break;
+                    }
+                }
+                if (!collision)
+                    return M;
+            }
+            return 256;
+        }
+
+        static constexpr size_t kRecvHashModulus = received_cmd_hash_modulus();
+
+        template<class StructT>
+        static constexpr auto make_received_cmd_dispatch_table()
+        {
+            std::array<cmd_dispatch_entry_t, kRecvHashModulus> res{};
+            auto add = [&]<class CmdType, auto memPtr>(CmdType *, std::integral_constant<decltype(memPtr), memPtr>){
+                if constexpr (CmdType::is_received())
+                    res[CmdType::kCmdId % kRecvHashModulus] = {.id = CmdType::kCmdId, .h = &CmdType::raw_handler, .field = &cmd_field_getter<StructT, memPtr>};
+            };
+            (add((typename mem_ptr_traits<decltype(cmdMemberDesc)>::MemberType*)nullptr, std::integral_constant<decltype(cmdMemberDesc), cmdMemberDesc>{}),...);
+            return res;
+        }
+
+        template<class StructT>
+        static constexpr auto kRecvDispatchTable = make_received_cmd_dispatch_table<StructT>();
+
+        //O(1) regardless of the amount of commands: one modulo, one table load, one id compare
+        template<class StructT>
+        static constexpr raw_handler_result_t find_cmd_handler(uint8_t id, StructT *pStruct)
+        {
+            if constexpr (count_received() == 0)
+                return {};
+            else
+            {
+                auto const &e = kRecvDispatchTable<StructT>[id % kRecvHashModulus];
+                if (!e.h || e.id != id)
+                    return {};
+                return {.h = e.h, .field = e.field(pStruct)};
+            }
+        }
+
         template<auto... cmdMemberDesc2>
         friend constexpr auto operator+(cluster_commands_desc_t<cmdMemberDesc...> lhs, cluster_commands_desc_t<cmdMemberDesc2...> rhs)
         {
@@ -439,8 +610,11 @@ namespace zb
         static constexpr inline size_t count_members_with_access(access_t a) { return attributes.count_members_with_access(a); }
         static constexpr inline size_t count_cvc_members() { return attributes.count_cvc_members(); }
         static constexpr inline size_t count_members_with_validators() { return attributes.count_members_with_validators(); }
+        static constexpr inline size_t count_members_with_report_defaults() { return attributes.count_members_with_report_defaults(); }
+        static constexpr inline auto get_report_defaults() { return attributes.report_defaults(); }
         static constexpr inline auto max_command_arg_raw_size() { return cmds.max_command_arg_raw_size(); }
         static constexpr inline size_t count_generated() { return cmds.count_generated(); }
+        static constexpr inline size_t cmd_queue_demand() { return cmds.cmd_queue_demand(); }
         static constexpr inline size_t count_received() { return cmds.count_received(); }
         static constexpr inline auto get_generated_commands() { return cmds.get_generated_commands(); }
         static constexpr inline auto get_received_commands() { return cmds.get_received_commands(); }
@@ -450,6 +624,12 @@ namespace zb
         template<auto memPtr>
         static constexpr inline auto get_member_description() { return attributes.template get_member_description<memPtr>(); }
 
+        template<auto memPtr>
+        static constexpr inline size_t get_member_index() { return attributes.index_of_attribute(get_member_description<memPtr>().id); }
+        template<auto memPtr>
+        static constexpr inline size_t get_reportable_member_index() { return attributes.reportable_index_of(get_member_description<memPtr>().id); }
+        static constexpr inline auto get_reportable_attribute_ids() { return attributes.reportable_attribute_ids(); }
+
         template<auto memPtr>
         static constexpr inline auto get_cmd_description() { return cmds.template get_cmd_description<memPtr>(); }
 
@@ -533,12 +713,52 @@ namespace zb
             else
                 return 0;
         }
+        static constexpr size_t cmd_queue_demand() { return (T::cmd_queue_demand() + ... + 0); }
         static constexpr size_t reporting_attributes_count() { return (T::attributes_with_access(access_t::Report) + ... + 0); }
         static constexpr size_t cvc_attributes_count() { return (T::cvc_attributes() + ... + 0); }
 
         static constexpr size_t server_cluster_count() { return (T::is_role(role_t::Server) + ... + 0); }
         static constexpr size_t client_cluster_count() { return (T::is_role(role_t::Client) + ... + 0); }
         static constexpr bool has_info(cluster_info_t ci) { return ((T::info() == ci) || ...); }
+        static constexpr size_t index_of(cluster_info_t ci)
+        {
+            size_t res = 0;
+            ((!(T::info() == ci) && ++res) && ...);
+            return res;
+        }
+        template<size_t I>
+        using cluster_at_t = std::tuple_element_t<I, std::tuple<T...>>;
+
+        struct reportable_attr_t
+        {
+            uint16_t cluster;
+            uint16_t attr;
+            uint8_t role;
+        };
+
+        //amount of reportable attributes in clusters preceding the cluster at index 'idx'
+        static constexpr size_t reportable_attributes_before(size_t idx)
+        {
+            size_t i = 0, res = 0;
+            ((i++ < idx && (res += T::attributes_with_access(access_t::Report), true)) && ...);
+            return res;
+        }
+
+        //all reportable attributes of the EP in cluster order, see reportable_attributes_before
+        static constexpr auto reportable_attributes()
+        {
+            std::array<reportable_attr_t, reporting_attributes_count()> res{};
+            size_t i = 0;
+            auto add = [&]<class C>(C *){
+                for(uint16_t id : C::Tag::get_reportable_attribute_ids())
+                    res[i++] = {.cluster = C::info().id, .attr = id, .role = (uint8_t)C::info().role};
+            };
+            (add((T*)nullptr), ...);
+            return res;
+        }
+
+        static constexpr size_t metadata_ram_size() { return (T::metadata_ram_size() + ... + 0); }
+        static constexpr size_t cmd_lists_in_flash() { return (T::cmd_lists_in_flash() + ... + 0); }
 
         constexpr cluster_list_t(T&... d):
             clusters{ d.template desc<ep>()... }
@@ -644,6 +864,54 @@ namespace zb
     using global_error_handler_t = void(*)(zb_ret_t r);
     inline global_error_handler_t g_GlobalErrorHandler = nullptr;
 
+    template<class StructTag, uint8_t ep>
+    void install_report_defaults()
+    {
+        constexpr auto d = zcl_description_t<StructTag>::get();
+        constexpr auto ci = d.info();
+        static constexpr auto kDefaults = d.get_report_defaults();
+        for(auto const& r : kDefaults)
+        {
+            zb_zcl_reporting_info_t rep_info;
+            zb_zcl_reporting_info_t *pCur = zb_zcl_find_reporting_info(ep, ci.id, (zb_uint8_t)ci.role, r.id);
+            if (pCur)
+            {
+                //intervals differing from the entry's own defaults or a delta that's neither the declared one nor
+                //the 0 of a fresh ZBOSS entry (ZBOSS keeps no default delta): configured by a coordinator
+                //(Configure Reporting or restored from NVRAM), that wins over the declared defaults
+                auto const& si = pCur->u.send_info;
+                if (si.min_interval != si.def_min_interval || si.max_interval != si.def_max_interval)
+                    continue;
+                constexpr std::array<uint8_t, 4> kNoDelta{};
+                if (std::memcmp(&si.delta, r.delta.data(), r.delta_size) && std::memcmp(&si.delta, kNoDelta.data(), r.delta_size))
+                    continue;
+                rep_info = *pCur;
+            }
+            else
+            {
+                std::memset(&rep_info, 0, sizeof(rep_info));
+                rep_info.direction = ZB_ZCL_CONFIGURE_REPORTING_SEND_REPORT;
+                rep_info.ep = ep;
+                rep_info.cluster_id = ci.id;
+                rep_info.cluster_role = (zb_uint8_t)ci.role;
+                rep_info.attr_id = r.id;
+                rep_info.manuf_code = ci.manuf_code;
+                rep_info.dst.profile_id = ZB_AF_HA_PROFILE_ID;
+            }
+            if (r.max_interval)//0 - keep the intervals ZBOSS has
+            {
+                rep_info.u.send_info.min_interval = r.min_interval;
+                rep_info.u.send_info.max_interval = r.max_interval;
+                rep_info.u.send_info.def_min_interval = r.min_interval;
+                rep_info.u.send_info.def_max_interval = r.max_interval;
+            }
+            std::memcpy(&rep_info.u.send_info.delta, r.delta.data(), r.delta_size);
+            zb_ret_t ret = zb_zcl_put_reporting_info(&rep_info, ZB_TRUE);
+            if (ret != RET_OK && g_GlobalErrorHandler)
+                g_GlobalErrorHandler(ret);
+        }
+    }
+
     template<class StructTag, uint8_t ep>
     void generic_cluster_init()
     {
@@ -665,6 +933,9 @@ namespace zb
         if constexpr (d.count_members_with_validators() > 0)
             check_val = &on_cluster_check_value<StructTag, ep>;
 
+        if constexpr (d.count_members_with_report_defaults() > 0)
+            install_report_defaults<StructTag, ep>();
+
         if (check_val || write_hook || cmd_handler)
         {
             constexpr auto i = d.info();
@@ -5,6 +5,10 @@
 #include "nrfzbcpp/zb_buf.hpp"
 #include "zb_desc_helper_types_cluster.hpp"
 #include "nrfzbcpp/zb_alarm.hpp"
+#include "nrfzbcpp/zb_coro.hpp"
+#include <algorithm>
+#include <tuple>
+#include <bit>
 
 namespace zb
 {
@@ -48,6 +52,11 @@ namespace zb
                 && ((_cluster == cluster) || (cluster == kANY_CLUSTER))
                 && ((_attr == attribute) || (attribute == kANY_ATTRIBUTE));
         }
+
+        //(ep, cluster, attr) packed so that keys sort by ep, then cluster, then attribute
+        static constexpr uint64_t make_key(zb_uint8_t _ep, uint16_t _cluster, uint16_t _attr) { return (uint64_t(_ep) << 32) | (uint32_t(_cluster) << 16) | _attr; }
+        constexpr uint64_t key() const { return make_key(ep, cluster, attribute); }
+        constexpr bool is_exact() const { return ep != kANY_EP && cluster != kANY_CLUSTER && attribute != kANY_ATTRIBUTE; }
     };
 
     struct ep_base_info_t
@@ -55,7 +64,10 @@ namespace zb
         zb_uint8_t ep;
         zb_uint16_t dev_id;
         zb_uint8_t dev_ver;
-        uint8_t cmd_queue_depth = 2;//0 - auto
+        uint8_t cmd_queue_depth = 2;//0 - auto: from the generated commands of the EP's clusters (see cluster_list_t::cmd_queue_demand)
+        uint8_t pending_queue_depth = 0;//commands deferred while no pre-allocated buffer is available, 0 - fail right away
+        bool shared_cmd_bufs = false;//take command buffers from the device-wide pool (see device_full_t) instead of owning cmd_queue_depth of them
+        uint8_t cmd_bufs_reserved = 0;//shared_cmd_bufs only: buffers of the shared pool no other EP can take
     };
 
     using cmd_id_t = uint8_t;
@@ -65,6 +77,7 @@ namespace zb
     {
         cmd_send_status_cb_t cb;
         uint32_t timeout_ms = kCmdTimeoutDefault;
+        bool resume_waiter = false;//set by send_cmd_async: the completion resumes the awaiting coroutine instead of 'cb'
     };
 
     template<auto memPtr>
@@ -109,11 +122,191 @@ namespace zb
     template<class C>
     concept is_zb_addr_type_c = requires{ typename C::addr_tag; };
 
+    template<auto memPtr>
+    using attr_mem_type_t = typename mem_ptr_traits<decltype(memPtr)>::MemberType;
+
+    //ep.shadow_attr<memPtr>() = v; see ep_desc_t::shadow_store
+    template<class EP, auto memPtr>
+    struct shadow_attribute_access_t
+    {
+        bool operator=(attr_mem_type_t<memPtr> const& v) { return ep.template shadow_store<memPtr>(v); }
+
+        EP &ep;
+    };
+
+    //Stages typed attribute writes (any clusters of one EP) and applies them in commit(): a value equal to
+    //the attribute storage is skipped, every changed one is an ordinary ep.attr<memPtr>() = v
+    //(one zb_zcl_set_attr_val each). A compare-and-skip convenience, not a batch: no lookups are shared
+    template<class EP, auto... memPtrs>
+    struct attr_transaction_t
+    {
+        template<auto memPtr>
+        [[nodiscard]] auto set(attr_mem_type_t<memPtr> const& v) &&
+        {
+            return attr_transaction_t<EP, memPtrs..., memPtr>{.ep = ep, .values = std::tuple_cat(std::move(values), std::tuple{v})};
+        }
+
+        //returns RET_OK or the first error of zb_zcl_set_attr_val (the remaining values are still written)
+        zb_ret_t commit() &&
+        {
+            zb_ret_t res = RET_OK;
+            auto set = [&]<auto memPtr>(attr_mem_type_t<memPtr> const& v){
+                if (std::memcmp(&ep.template attr_storage<memPtr>(), &v, sizeof(v)) == 0)
+                    return;
+                zb_ret_t r = ep.template attr<memPtr>() = v;
+                if (res == RET_OK)
+                    res = r;
+            };
+            [&]<size_t... I>(std::index_sequence<I...>){
+                (set.template operator()<memPtrs>(std::get<I>(values)), ...);
+            }(std::make_index_sequence<sizeof...(memPtrs)>{});
+            return res;
+        }
+
+        EP &ep;
+        std::tuple<attr_mem_type_t<memPtrs>...> values;
+    };
+
+    //N slots of T, indexed by the ZBOSS buffer id the slot was acquired for.
+    //Slots are taken from a bitmap, buffer ids are looked up in an open-addressing table
+    //(linear probing, at most half full), so acquire/find/release don't depend on N.
+    //ZB_BUF_INVALID (0) marks an empty index cell, so a zero-initialized object is empty
+    template<class T, size_t N>
+    struct buf_keyed_slots_t
+    {
+        static_assert(N <= 256, "slot numbers are stored as uint8_t: at most 256 slots");
+        static constexpr size_t kIndexSize = std::bit_ceil(std::max(N * 2, size_t(2)));
+        static constexpr size_t kIndexMask = kIndexSize - 1;
+
+        //returns nullptr if all slots are taken
+        T* acquire(zb_bufid_t b)
+        {
+            for(size_t w = 0; w < m_Used.size(); ++w)
+            {
+                if (m_Used[w] == uint32_t(-1))
+                    continue;
+                size_t slot = w * 32 + std::countr_one(m_Used[w]);
+                if (slot >= N)
+                    break;
+                m_Used[w] |= 1u << (slot % 32);
+                size_t c = b & kIndexMask;
+                while(m_Keys[c] != ZB_BUF_INVALID)
+                    c = (c + 1) & kIndexMask;
+                m_Keys[c] = b;
+                m_Slots[c] = uint8_t(slot);
+                return &m_Entries[slot];
+            }
+            return nullptr;
+        }
+
+        T* find(zb_bufid_t b)
+        {
+            size_t c = find_cell(b);
+            return c != kIndexSize ? &m_Entries[m_Slots[c]] : nullptr;
+        }
+
+        //returns false if nothing was acquired for the buffer
+        bool release(zb_bufid_t b)
+        {
+            size_t c = find_cell(b);
+            if (c == kIndexSize)
+                return false;
+            size_t slot = m_Slots[c];
+            m_Used[slot / 32] &= ~(1u << (slot % 32));
+            //backward shift deletion: no tombstones, probe sequences stay short
+            for(size_t j = (c + 1) & kIndexMask; m_Keys[j] != ZB_BUF_INVALID; j = (j + 1) & kIndexMask)
+            {
+                size_t home = m_Keys[j] & kIndexMask;
+                if (((j - home) & kIndexMask) >= ((j - c) & kIndexMask))
+                {
+                    m_Keys[c] = m_Keys[j];
+                    m_Slots[c] = m_Slots[j];
+                    c = j;
+                }
+            }
+            m_Keys[c] = ZB_BUF_INVALID;
+            return true;
+        }
+
+        auto& entries() { return m_Entries; }
+
+    private:
+        size_t find_cell(zb_bufid_t b) const
+        {
+            if (b == ZB_BUF_INVALID)
+                return kIndexSize;
+            for(size_t c = b & kIndexMask; m_Keys[c] != ZB_BUF_INVALID; c = (c + 1) & kIndexMask)
+            {
+                if (m_Keys[c] == b)
+                    return c;
+            }
+            return kIndexSize;
+        }
+
+        std::array<T, N> m_Entries{};
+        std::array<uint32_t, (N + 31) / 32> m_Used{};
+        zb_bufid_t m_Keys[kIndexSize]{};
+        uint8_t m_Slots[kIndexSize]{};
+    };
+
+    //bounded FIFO with in-place entries (entries are never moved while queued)
+    template<class T, size_t N>
+    struct fixed_fifo_t
+    {
+        bool empty() const { return m_Count == 0; }
+        size_t size() const { return m_Count; }
+        T& front() { return m_Entries[m_Head]; }
+
+        //returns nullptr if the queue is full
+        T* push_back()
+        {
+            if (m_Count == N)
+                return nullptr;
+            return &m_Entries[(m_Head + m_Count++) % N];
+        }
+
+        void pop_front()
+        {
+            m_Head = (m_Head + 1) % N;
+            --m_Count;
+        }
+
+        template<class F>
+        void for_each(F &&f)
+        {
+            for(size_t c = 0; c < m_Count; ++c)
+                f(m_Entries[(m_Head + c) % N]);
+        }
+
+    private:
+        std::array<T, N> m_Entries{};
+        size_t m_Head = 0;
+        size_t m_Count = 0;
+    };
+
+    //no queue at all (pending_queue_depth = 0): always empty, nothing can be queued
+    template<class T>
+    struct fixed_fifo_t<T, 0>
+    {
+        bool empty() const { return true; }
+        size_t size() const { return 0; }
+        T* push_back() { return nullptr; }
+
+        template<class F>
+        void for_each(F &&) {}
+    };
+
     template<ep_base_info_t i, class Clusters>
     struct ep_desc_t
     {
         using SimpleDesc = simple_desc_t<Clusters::server_cluster_count(), Clusters::client_cluster_count()>;
-        static constexpr auto kCmdQueueSize = i.cmd_queue_depth;
+        static constexpr size_t kMaxAutoCmdQueueSize = 8;
+        static constexpr size_t kCmdQueueSize = i.cmd_queue_depth ? i.cmd_queue_depth : std::min(Clusters::cmd_queue_demand(), kMaxAutoCmdQueueSize);
+        static constexpr auto kPendingQueueSize = i.pending_queue_depth;
+        static constexpr bool kSharedCmdBufs = i.shared_cmd_bufs;
+        static constexpr size_t kCmdBufsReserved = i.cmd_bufs_reserved;
+        static_assert(kSharedCmdBufs || !kCmdBufsReserved, "cmd_bufs_reserved requires shared_cmd_bufs");
+        static_assert(kCmdBufsReserved <= kCmdQueueSize, "cmd_bufs_reserved can't exceed the command queue size");
         static constexpr auto kCmdMaxArgsSize = Clusters::max_command_arg_raw_size();
         static constexpr size_t kMaxAllowedArgumentSize = 100;
         static_assert(kCmdMaxArgsSize <= kMaxAllowedArgumentSize, "Too much data for command arguments");
@@ -146,9 +339,9 @@ namespace zb
                 .cluster_desc_list = clusters.clusters,
                 .simple_desc = &simple_desc,
                 .rep_info_count = Clusters::reporting_attributes_count(),
-                .reporting_info = rep_ctx,
+                .reporting_info = rep_ctx.data(),
                 .cvc_alarm_count = Clusters::cvc_attributes_count(),
-                .cvc_alarm_info = cvc_alarm_ctx
+                .cvc_alarm_info = cvc_alarm_ctx.data()
             }
         {
         }
@@ -180,9 +373,9 @@ namespace zb
                 .cluster_desc_list = clusters.clusters,
                 .simple_desc = &simple_desc,
                 .rep_info_count = Clusters::reporting_attributes_count(),
-                .reporting_info = rep_ctx,
+                .reporting_info = rep_ctx.data(),
                 .cvc_alarm_count = Clusters::cvc_attributes_count(),
-                .cvc_alarm_info = cvc_alarm_ctx
+                .cvc_alarm_info = cvc_alarm_ctx.data()
             }
         {
         }
@@ -216,72 +409,213 @@ namespace zb
             return attribute_access_t<ClusterDescType::info(), ClusterDescType::template get_member_description<memPtr>(), checked>{ep};
         }
 
-        struct issued_cmd_t
+        //the timeout is a node of the alarm timer wheel: all in-flight commands of all EPs share one ZBOSS alarm,
+        //arming and cancelling it is O(1)
+        struct issued_cmd_t: timer_node_t
         {
             cmd_send_status_cb_t cb = nullptr;
             zb_bufid_t buf = ZB_BUF_INVALID;
             cmd_id_t cmd_id;
         };
 
-        inline static cmd_id_t g_cmd_num = 0;
-        inline static pre_alloc_zb_bufs_out<kCmdQueueSize> g_PreAllocBufs;
-        inline static std::array<issued_cmd_t, kCmdQueueSize> g_IssuedCmds;
+        //a command waiting for a pre-allocated buffer, arguments are already serialized
+        struct pending_cmd_t: request_runtime_args_raw_t<std::max(size_t(kCmdMaxArgsSize), size_t(1))>
+        {
+            using send_func_t = void(*)(zb_bufid_t b, pending_cmd_t &cmd);
+            send_func_t send = nullptr;
+            cmd_id_t cmd_id = 0;
+        };
 
-        static issued_cmd_t* find_free_issued_cmd_entry()
+        //a coroutine suspended in send_cmd_async until its command is acked, failed or timed out
+        struct cmd_waiter_t
         {
-            for(auto &cmd : g_IssuedCmds)
-            {
-                if (cmd.buf == ZB_BUF_INVALID)
-                    return &cmd;
-            }
-            return nullptr;
+            cmd_id_t cmd_id;
+            zb_ret_t status = RET_OK;
+            std::coroutine_handle<> h;
+        };
+
+        inline static cmd_id_t g_cmd_num = 0;
+        using cmd_bufs_t = std::conditional_t<kSharedCmdBufs, shared_zb_bufs_ref_t, pre_alloc_zb_bufs_out<kCmdQueueSize>>;
+        inline static cmd_bufs_t g_PreAllocBufs;
+        inline static buf_keyed_slots_t<issued_cmd_t, kCmdQueueSize> g_IssuedCmds;
+        inline static fixed_fifo_t<pending_cmd_t, kPendingQueueSize> g_PendingCmds;
+        inline static bool g_Draining = false;
+        inline static std::array<cmd_waiter_t*, kCmdQueueSize + kPendingQueueSize> g_CmdWaiters{};
+        //dirty flags of shadow attributes, bit index is the index in Clusters::reportable_attributes()
+        inline static std::array<uint32_t, (Clusters::reporting_attributes_count() + 31) / 32> g_ShadowDirty{};
+
+        //decided from the config alone: comparing &on_cmd_waiter_done to nullptr isn't a constant expression
+        //for gcc 12 with -fsanitize=undefined
+        template<send_cmd_config_t cfg>
+        static constexpr bool kHasStatusCb = cfg.resume_waiter || cfg.cb != nullptr;
+
+        template<send_cmd_config_t cfg>
+        static constexpr cmd_send_status_cb_t status_cb()
+        {
+            if constexpr (cfg.resume_waiter)
+                return &on_cmd_waiter_done;
+            else
+                return cfg.cb;
         }
 
-        static void on_send_cmd_timeout2(zb_bufid_t buf)
+        //May run inside drain_pending_cmds (a queued command failed to send). The awaiter is free to
+        //send_cmd/cancel_cmd from there: the command is already off the queue and the drain is not re-entered
+        static void resume_cmd_waiter(cmd_id_t id, zb_ret_t status)
         {
-            for(auto &cmd : g_IssuedCmds)
+            for(auto &pW : g_CmdWaiters)
             {
-                if (cmd.buf == buf)
+                if (pW && pW->cmd_id == id)
                 {
-                    //printk("on_send_cmd_timeout2: %d\r\n", buf);
-                    //g_PreAllocBufs.deallocate(cmd.buf);
-                    cmd.buf = ZB_BUF_INVALID;
-                    cmd.cb(cmd.cmd_id, nullptr);
+                    cmd_waiter_t *pWaiter = std::exchange(pW, nullptr);
+                    pWaiter->status = status;
+                    pWaiter->h.resume();
                     return;
                 }
             }
-            ZB_ASSERT(false);
+        }
+
+        static void on_cmd_waiter_done(cmd_id_t id, zb_zcl_command_send_status_t *pStatus)
+        {
+            resume_cmd_waiter(id, pStatus ? pStatus->status : RET_TIMEOUT);
+        }
+
+        static void on_send_cmd_timeout(timer_node_t &n)
+        {
+            on_send_cmd_timeout2(static_cast<issued_cmd_t&>(n).buf);
+        }
+
+        static void on_send_cmd_timeout2(zb_bufid_t buf)
+        {
+            issued_cmd_t *pCmd = g_IssuedCmds.find(buf);
+            ZB_ASSERT(pCmd);
+            if (!pCmd)
+                return;
+            //printk("on_send_cmd_timeout2: %d\r\n", buf);
+            //the buffer itself is returned to g_PreAllocBufs in on_send_cmd_cb2
+            issued_cmd_t cmd = *pCmd;
+            pCmd->buf = ZB_BUF_INVALID;
+            g_IssuedCmds.release(buf);
+            cmd.cb(cmd.cmd_id, nullptr);
         }
 
         static void on_send_cmd_cb2(zb_uint8_t buf)
         {
-            for(auto &cmd : g_IssuedCmds)
+            if (issued_cmd_t *pCmd = g_IssuedCmds.find(buf))
             {
-                if (cmd.buf == buf)
-                {
-                    //printk("on_send_cmd_cb2: %d (cmd_id == %d)\r\n", buf, cmd.cmd_id);
-                    zb_schedule_alarm_cancel(on_send_cmd_timeout2, buf, nullptr);
-                    zb_zcl_command_send_status_t *cmd_send_status = buf ? ZB_BUF_GET_PARAM(buf, zb_zcl_command_send_status_t) : nullptr;
-                    g_PreAllocBufs.deallocate(cmd.buf);//cmd_send_status memory is still valid
-                    cmd.buf = ZB_BUF_INVALID;
-                    cmd.cb(cmd.cmd_id, cmd_send_status);
-                    return;
-                }
+                //printk("on_send_cmd_cb2: %d (cmd_id == %d)\r\n", buf, pCmd->cmd_id);
+                zb_alarm_t::g_Wheel.cancel(*pCmd);
+                zb_zcl_command_send_status_t *cmd_send_status = buf ? ZB_BUF_GET_PARAM(buf, zb_zcl_command_send_status_t) : nullptr;
+                issued_cmd_t cmd = *pCmd;
+                pCmd->buf = ZB_BUF_INVALID;
+                g_IssuedCmds.release(buf);
+                g_PreAllocBufs.deallocate(buf);//cmd_send_status memory is still valid
+                cmd.cb(cmd.cmd_id, cmd_send_status);
+                on_cmd_buf_returned();
+                return;
             }
             //need to return either way, even if there was a timeout
             g_PreAllocBufs.deallocate(buf);
             //printk("on_send_cmd_cb2: %d; not found\r\n", buf);
+            on_cmd_buf_returned();
+        }
+
+        //with a shared pool the buffer may be the one a command of another EP is waiting for
+        static void on_cmd_buf_returned()
+        {
+            if constexpr (kSharedCmdBufs)
+                g_PreAllocBufs.drain();
+            else
+                drain_pending_cmds();
+        }
+
+        //sends queued commands in order for as long as there are free pre-allocated buffers
+        //A command is taken off the queue before it's sent: a failure is reported (status callback,
+        //resumed send_cmd_async awaiter) with the queue already consistent, so the callback may send or cancel
+        //commands. Calls made from there return right away, the running loop picks up what they queued
+        static void drain_pending_cmds()
+        {
+            if constexpr (kPendingQueueSize > 0)
+            {
+                if (g_Draining)
+                    return;
+                g_Draining = true;
+                while(!g_PendingCmds.empty())
+                {
+                    pending_cmd_t &front = g_PendingCmds.front();
+                    if (front.canceled)
+                    {
+                        g_PendingCmds.pop_front();
+                        continue;
+                    }
+                    if (!g_PreAllocBufs.available())
+                        break;
+                    pending_cmd_t cmd = front;
+                    cmd.args_raw = {cmd.raw, front.args_raw.size()};
+                    g_PendingCmds.pop_front();
+                    cmd.send(g_PreAllocBufs.allocate(), cmd);
+                }
+                g_Draining = false;
+            }
+        }
+
+        template<auto memPtr, send_cmd_config_t cfg>
+        static void send_pending_cmd(zb_bufid_t b, pending_cmd_t &cmd)
+        {
+            bool sent = send_on_buf<memPtr, cfg>(b, cmd.dst_addr, cmd.addr_mode, cmd.dst_ep, cmd.cmd_id, [&](uint8_t *ptr){
+                    std::memcpy(ptr, cmd.args_raw.data(), cmd.args_raw.size());
+                    return ptr + cmd.args_raw.size();
+            });
+            //the caller got a cmd_id already, so the failure is reported the same way as a timeout
+            if constexpr (kHasStatusCb<cfg>)
+            {
+                if (!sent)
+                    status_cb<cfg>()(cmd.cmd_id, nullptr);
+            }
         }
 
         template<auto memPtr, send_cmd_config_t cfg={}, class... Args> requires (!is_zb_addr_type_c<Args> && ...)
         [[nodiscard]] std::optional<cmd_id_t> send_cmd_impl(zb_addr_u addr, addr_mode_t mode, uint8_t dst_ep, Args&&...args)
         {
-            zb_bufid_t b = g_PreAllocBufs.allocate();
+            static_assert(kCmdQueueSize > 0, "EP has no command buffers (check cmd_queue_depth)");
+            using cmd_desc_t = cmd_description_for_mem_ptr_t<memPtr>;
+            drain_pending_cmds();
+            //nothing overtakes already queued commands
+            zb_bufid_t b = (g_PendingCmds.empty() && g_PreAllocBufs.available()) ? g_PreAllocBufs.allocate() : ZB_BUF_INVALID;
             if (b == ZB_BUF_INVALID)
+            {
+                if constexpr (kPendingQueueSize > 0)
+                {
+                    pending_cmd_t *pCmd = g_PendingCmds.push_back();
+                    if (!pCmd)
+                        return std::nullopt;
+                    static_assert(total_serialize_limit<std::remove_cvref_t<Args>...>() <= sizeof(pCmd->raw), "Arguments don't fit into the pending command storage. Pass them with the exact types of the command");
+                    uint8_t *pEnd = cmd_desc_t::cmd_prepare_t::store_to(pCmd->raw, sizeof(pCmd->raw), std::forward<Args>(args)...);
+                    pCmd->args_raw = {pCmd->raw, size_t(pEnd - pCmd->raw)};
+                    pCmd->dst_addr = addr;
+                    pCmd->dst_ep = dst_ep;
+                    pCmd->addr_mode = mode;
+                    pCmd->canceled = false;
+                    pCmd->send = &send_pending_cmd<memPtr, cfg>;
+                    pCmd->cmd_id = g_cmd_num;
+                    return g_cmd_num++;
+                }
                 return std::nullopt;
-            issued_cmd_t *pIssued = find_free_issued_cmd_entry();
-            ZB_ASSERT(pIssued);//size of issued array and pre-allocated are the same
-            //so it must be valid
+            }
+
+            bool sent = send_on_buf<memPtr, cfg>(b, addr, mode, dst_ep, g_cmd_num, [&](uint8_t *ptr){
+                    return cmd_desc_t::cmd_prepare_t::store_to(ptr, kMaxAllowedArgumentSize, std::forward<Args>(args)...);
+            });
+            if (!sent)
+                return std::nullopt;
+            //printk("send_cmd_impl(%d): ok. cmd_id=%d\r\n", b, g_cmd_num);
+            return g_cmd_num++;
+        }
+
+        //builds and sends the command on the pre-allocated buffer 'b', 'store_args' writes the payload
+        //on failure the buffer is taken care of
+        template<auto memPtr, send_cmd_config_t cfg, class StoreArgs>
+        static bool send_on_buf(zb_bufid_t b, zb_addr_u addr, addr_mode_t mode, uint8_t dst_ep, cmd_id_t cmd_id, StoreArgs &&store_args)
+        {
             using cmd_desc_t = cmd_description_for_mem_ptr_t<memPtr>;
             using ClusterDescType = cluster_description_for_mem_ptr_t<memPtr>;
             constexpr auto kTimeout = cfg.timeout_ms == kCmdTimeoutDefault ? cmd_desc_t::timeout_ms() : cfg.timeout_ms;
@@ -295,37 +629,45 @@ namespace zb
             }};
             ZB_ZCL_GET_SEQ_NUM();
             uint8_t* ptr = (uint8_t*)zb_zcl_start_command_header(b, f.u8, manu_code, cmd_desc_t::kCmdId, nullptr);
-            ptr = cmd_desc_t::cmd_prepare_t::store_to(ptr, kMaxAllowedArgumentSize, std::forward<Args>(args)...);
+            ptr = store_args(ptr);
             zb_ret_t ret = zb_zcl_finish_and_send_packet(b, ptr, &addr, (uint8_t)mode/*addr mode*/, dst_ep, i.ep, ZB_AF_HA_PROFILE_ID, ci.id, on_send_cmd_cb2);
             if (RET_OK != ret)
             {
                 //printk("send_cmd_impl(%d): failed to send %d\r\n", b, ret);
                 g_PreAllocBufs.deallocate(b);
-                return std::nullopt;
+                return false;
             }
 
-            if constexpr (cfg.cb)
+            if constexpr (kHasStatusCb<cfg>)
             {
+                issued_cmd_t *pIssued = g_IssuedCmds.acquire(b);
+                ZB_ASSERT(pIssued);//size of issued slots and pre-allocated are the same
+                //so it must be valid
                 pIssued->buf = b;
-                pIssued->cb = cfg.cb;
-                pIssued->cmd_id = g_cmd_num;
-                if ((ret = zb_schedule_app_alarm(on_send_cmd_timeout2, b, ZB_MILLISECONDS_TO_BEACON_INTERVAL(kTimeout))) != RET_OK)
+                pIssued->cb = status_cb<cfg>();
+                pIssued->cmd_id = cmd_id;
+                //timeout_ms == 0: no timeout, wait for the APS confirmation only
+                if constexpr (kTimeout != 0)
                 {
-                    //printk("send_cmd_impl(%d): failed to arm the alarm %d\r\n", b, ret);
-                    pIssued->buf = ZB_BUF_INVALID;
-                    g_PreAllocBufs.deallocate(b);
-                    return std::nullopt;
+                    pIssued->m_Handler = &on_send_cmd_timeout;
+                    zb_alarm_t::g_Wheel.arm(*pIssued, ZB_TIMER_GET() + ZB_MILLISECONDS_TO_BEACON_INTERVAL(kTimeout));
                 }
             }
-
-            //printk("send_cmd_impl(%d): ok. cmd_id=%d\r\n", b, g_cmd_num);
-            return g_cmd_num++;
+            return true;
         }
 
     public:
-        void init()
+        //returns amount of command buffer allocation failures
+        int init()
         {
-            g_PreAllocBufs.init();
+            return g_PreAllocBufs.init();
+        }
+
+        //called by the owner of the shared pool before init()
+        template<class Pool> requires kSharedCmdBufs
+        static void attach_cmd_bufs(Pool &pool, uint8_t client)
+        {
+            g_PreAllocBufs = pool.attach(client, kCmdBufsReserved, kCmdQueueSize, &drain_pending_cmds);
         }
 
         template<auto memPtr>
@@ -334,10 +676,144 @@ namespace zb
         template<auto memPtr>
         auto attr_checked() { return attr_raw<memPtr, true>(); }
 
+        //ep.transaction().set<kTemp>(t).set<kHumid>(h).commit();
+        [[nodiscard]] auto transaction() { return attr_transaction_t<ep_desc_t>{.ep = *this}; }
+
+        //true if the EP declares the attribute, e.g. the power config cluster may be declared
+        //with zb_zcl_power_cfg_battery_info_t or with zb_zcl_power_cfg_battery_settings_t
+        template<auto memPtr>
+        static constexpr bool has_attr()
+        {
+            using ClassType = mem_ptr_traits<decltype(memPtr)>::ClassType;
+            using ClusterDescType = decltype(zcl_description_t<ClassType>::get());
+            if constexpr (!Clusters::has_info(ClusterDescType::info()))
+                return false;
+            else
+            {
+                using AttrList = Clusters::template cluster_at_t<Clusters::index_of(ClusterDescType::info())>;
+                using StructType = std::remove_pointer_t<decltype(AttrList::cluster_struct)>;
+                return std::is_base_of_v<ClassType, StructType>;
+            }
+        }
+
+        //the actual storage of the attribute (member of the cluster struct)
+        template<auto memPtr>
+        attr_mem_type_t<memPtr>& attr_storage()
+        {
+            constexpr auto types = validate_mem_ptr<memPtr>();
+            using ClusterDescType = decltype(types)::ClusterType;
+            constexpr size_t kClusterIdx = Clusters::index_of(ClusterDescType::info());
+            constexpr size_t kAttrIdx = Clusters::template cluster_at_t<kClusterIdx>::template attr_desc_index<memPtr>();
+            return *(attr_mem_type_t<memPtr>*)ep.cluster_desc_list[kClusterIdx].attr_desc_list[kAttrIdx].data_p;
+        }
+
+        //writes the value straight into the attribute storage, returns true if the value has changed
+        //Bypasses everything zb_zcl_set_attr_val does besides the store: the access check, the cluster's
+        //check_value and write-attr hooks, marking for reporting (see mark_attr_for_reporting) and the
+        //CVC (alarm) evaluation. Only for values the caller has validated itself, e.g. shadow_store
+        template<auto memPtr>
+        bool store_attr(attr_mem_type_t<memPtr> const& v)
+        {
+            void *pData = &attr_storage<memPtr>();
+            if (std::memcmp(pData, &v, sizeof(v)) == 0)
+                return false;
+            std::memcpy(pData, &v, sizeof(v));
+            return true;
+        }
+
+        //ep.shadow_attr<memPtr>() = v;
+        template<auto memPtr>
+        auto shadow_attr() { return shadow_attribute_access_t<ep_desc_t, memPtr>{*this}; }
+
+        //Stores the value only if it differs from the current one by more than the attribute's 'deadband'
+        //(with 0 deadband - if it differs at all)
+        //A changed reportable attribute is only marked dirty, reporting is triggered by flush()
+        //returns true if the value was accepted
+        template<auto memPtr>
+        bool shadow_store(attr_mem_type_t<memPtr> const& v)
+        {
+            using MemT = attr_mem_type_t<memPtr>;
+            constexpr auto types = validate_mem_ptr<memPtr>();
+            using ClusterDescType = decltype(types)::ClusterType;
+            constexpr auto mem_desc = ClusterDescType::template get_member_description<memPtr>();
+            if constexpr (mem_desc.deadband != 0)
+            {
+                static_assert(std::is_arithmetic_v<MemT>, "deadband is only supported for arithmetic attributes");
+                //in double: no integer promotion/wrap-around surprises and no truncation of the deadband
+                double cur = double(attr_storage<memPtr>());
+                double diff = double(v) > cur ? double(v) - cur : cur - double(v);
+                if (diff <= mem_desc.deadband)
+                    return false;
+            }
+            if (!store_attr<memPtr>(v))
+                return false;
+
+            if constexpr (mem_desc.has_access(access_t::Report))
+            {
+                constexpr size_t kClusterIdx = Clusters::index_of(ClusterDescType::info());
+                constexpr size_t kBit = Clusters::reportable_attributes_before(kClusterIdx) 
+                    + Clusters::template cluster_at_t<kClusterIdx>::Tag::template get_reportable_member_index<memPtr>();
+                g_ShadowDirty[kBit / 32] |= 1u << (kBit % 32);
+            }
+            return true;
+        }
+
+        //marks all dirty shadow attributes for reporting
+        //returns RET_OK or the first error of zb_zcl_mark_attr_for_reporting
+        zb_ret_t flush()
+        {
+            static constexpr auto kReportable = Clusters::reportable_attributes();
+            zb_ret_t res = RET_OK;
+            for(size_t w = 0; w < g_ShadowDirty.size(); ++w)
+            {
+                uint32_t dirty = std::exchange(g_ShadowDirty[w], 0);
+                while(dirty)
+                {
+                    auto const& a = kReportable[w * 32 + std::countr_zero(dirty)];
+                    dirty &= dirty - 1;
+                    zb_ret_t r = zb_zcl_mark_attr_for_reporting(i.ep, a.cluster, a.role, a.attr);
+                    if (res == RET_OK)
+                        res = r;
+                }
+            }
+            return res;
+        }
+
+        template<auto memPtr>
+        zb_ret_t mark_attr_for_reporting()
+        {
+            constexpr auto types = validate_mem_ptr<memPtr>();
+            using ClusterDescType = decltype(types)::ClusterType;
+            constexpr auto ci = ClusterDescType::info();
+            constexpr auto mem_desc = ClusterDescType::template get_member_description<memPtr>();
+            if constexpr (mem_desc.has_access(access_t::Report))
+                return zb_zcl_mark_attr_for_reporting(i.ep, ci.id, (zb_uint8_t)ci.role, mem_desc.id);
+            else
+                return RET_OK;
+        }
+
+        //cancels a command that is still waiting in the pending queue
+        //returns false if the command was not found there (already sent or never deferred)
+        bool cancel_cmd(cmd_id_t id)
+        {
+            bool found = false;
+            g_PendingCmds.for_each([&](pending_cmd_t &cmd){
+                if (!cmd.canceled && cmd.cmd_id == id)
+                    cmd.canceled = found = true;
+            });
+            if (found)
+                resume_cmd_waiter(id, RET_ERROR);//a send_cmd_async awaiter would never be resumed otherwise
+            return found;
+        }
+
+        size_t pending_cmds() const { return g_PendingCmds.size(); }
+        //pre-allocated command buffers not in flight right now
+        size_t available_cmd_bufs() const { return g_PreAllocBufs.available(); }
+
         void dump_info()
         {
-            printk("g_cmd_num=%d;\r\n", g_cmd_num);
-            for(auto &cmd : g_IssuedCmds)
+            printk("g_cmd_num=%d; pending=%d\r\n", g_cmd_num, (int)g_PendingCmds.size());
+            for(auto &cmd : g_IssuedCmds.entries())
                 printk("cmd: id=%d; buf idx=%d\r\n", cmd.cmd_id, cmd.buf);
         }
 
@@ -373,6 +849,43 @@ namespace zb
             return send_cmd_impl<memPtr, cfg>(zb_addr_u{.addr_short = 0}, addr_mode_t::EPAsBindTableId, a.bind_table_id, std::forward<Args>(args)...);
         }
 
+        template<auto memPtr, uint32_t timeout_ms, class... Args>
+        struct send_cmd_awaiter_t
+        {
+            ep_desc_t &ep;
+            std::tuple<Args...> args;
+            cmd_waiter_t w{};
+
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                auto id = std::apply([&](auto&... a){
+                        return ep.template send_cmd<memPtr, send_cmd_config_t{.cb = nullptr, .timeout_ms = timeout_ms, .resume_waiter = true}>(a...);
+                }, args);
+                if (!id)
+                {
+                    w.status = RET_NO_MEMORY;
+                    return false;
+                }
+                //the completion can't come before this returns: it's always delivered from a ZBOSS callback
+                auto it = std::ranges::find(g_CmdWaiters, nullptr);
+                ZB_ASSERT(it != g_CmdWaiters.end());//one waiter per tracked/pending command at most
+                w.cmd_id = *id;
+                w.h = h;
+                *it = &w;
+                return true;
+            }
+            //RET_OK or the APS status once the command is acked, RET_TIMEOUT, RET_NO_MEMORY if it could not be sent/queued
+            zb_ret_t await_resume() const noexcept { return w.status; }
+        };
+
+        //zb_ret_t r = co_await ep.send_cmd_async<kCmd>(args...); - same targets and arguments as send_cmd
+        template<auto memPtr, uint32_t timeout_ms = kCmdTimeoutDefault, class... Args>
+        [[nodiscard]] auto send_cmd_async(Args&&...args)
+        {
+            return send_cmd_awaiter_t<memPtr, timeout_ms, std::decay_t<Args>...>{*this, {std::forward<Args>(args)...}};
+        }
+
         template<auto memPtr>
         constexpr ep_cluster_attribute_desc_t attribute_desc()
         {
@@ -395,8 +908,8 @@ namespace zb
         }
 
         alignas(4) SimpleDesc simple_desc;
-        alignas(4) zb_zcl_reporting_info_t rep_ctx[Clusters::reporting_attributes_count()];
-        alignas(4) zb_zcl_cvc_alarm_variables_t cvc_alarm_ctx[Clusters::cvc_attributes_count()];
+        alignas(4) std::array<zb_zcl_reporting_info_t, Clusters::reporting_attributes_count()> rep_ctx;
+        alignas(4) std::array<zb_zcl_cvc_alarm_variables_t, Clusters::cvc_attributes_count()> cvc_alarm_ctx;
         alignas(4) zb_af_endpoint_desc_t ep;
     };
 }
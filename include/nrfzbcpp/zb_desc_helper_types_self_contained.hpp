@@ -60,6 +60,8 @@ namespace zb
         using ClusterListType = zb::cluster_list_t<i.ep, to_attribute_list_type_t<ClusterTypes>...>;
 
         static constexpr zb_uint8_t ep_id() { return i.ep; }
+        static constexpr size_t metadata_ram_size() { return ClusterListType::metadata_ram_size(); }
+        static constexpr size_t cmd_lists_in_flash() { return ClusterListType::cmd_lists_in_flash(); }
 
         constexpr ep_desc_self_contained_t(ClusterTypes&...s):
             attributes{ zb::cluster_struct_to_attr_list(s, zb::zcl_description_t<ClusterTypes>::get())... },
@@ -113,9 +115,9 @@ namespace zb
         template<zb_uint8_t dummy>
         constexpr auto get(ep_tag_t<dummy>) { static_assert(sizeof(ep_tag_t<dummy>) == 0, "EP not found"); }
 
-        void init()
+        int init()
         {
-            (ep_container_mem_t<EPs>::m.ep.init(),...);
+            return (ep_container_mem_t<EPs>::m.ep.init() + ... + 0);
         }
     };
 
@@ -136,6 +138,23 @@ namespace zb
     {
         static_assert(ep_tools::kAllUniqueIds<EPSelfContainedTypes...>, "All EP ids must be unique!");
         static constexpr size_t N = sizeof...(EPSelfContainedTypes);
+        //cluster metadata RAM across all the endpoints (see NRFZBCPP_CMD_LISTS_IN_FLASH)
+        static constexpr size_t metadata_ram_size() { return (EPSelfContainedTypes::metadata_ram_size() + ... + 0); }
+        static constexpr size_t cmd_lists_in_flash() { return (EPSelfContainedTypes::cmd_lists_in_flash() + ... + 0); }
+
+        //command buffers shared by the EPs with shared_cmd_bufs: all the reservations plus enough
+        //on top for any single EP to reach its full kCmdQueueSize while the others hold only theirs
+        template<class EP>
+        static constexpr size_t shared_cmd_bufs_extra() { return EP::kSharedCmdBufs ? EP::kCmdQueueSize - EP::kCmdBufsReserved : 0; }
+        static constexpr size_t kSharedCmdBufsClients = (size_t(decltype(EPSelfContainedTypes::ep)::kSharedCmdBufs) + ... + 0);
+        static constexpr size_t kSharedCmdBufsReserved = ((decltype(EPSelfContainedTypes::ep)::kSharedCmdBufs ? decltype(EPSelfContainedTypes::ep)::kCmdBufsReserved : 0) + ... + 0);
+        static constexpr size_t kSharedCmdBufsSize = kSharedCmdBufsReserved + std::max({size_t(0), shared_cmd_bufs_extra<decltype(EPSelfContainedTypes::ep)>()...});
+        //only instantiated (and only takes RAM) when at least one EP has shared_cmd_bufs
+        using shared_cmd_bufs_t = shared_zb_bufs_out<kSharedCmdBufsSize, kSharedCmdBufsClients>;
+        inline static conditional_var_t<shared_cmd_bufs_t, (kSharedCmdBufsClients > 0)> g_SharedCmdBufs;
+
+        //free buffers of the shared pool
+        static size_t shared_cmd_bufs_available() requires (kSharedCmdBufsClients > 0) { return g_SharedCmdBufs.value.available(); }
 
         template<class... EPArgs>
         constexpr device_full_t(EPArgs..._eps):
@@ -151,7 +170,22 @@ namespace zb
         template<zb_uint8_t _ep>
         constexpr auto& ep_obj() { return eps.get(ep_tag_t<_ep>{}); }
 
-        void init() { return eps.init(); }
+        //returns amount of command buffer allocation failures (shared pool and per-EP ones)
+        int init()
+        {
+            int failed = 0;
+            if constexpr (kSharedCmdBufsClients > 0)
+            {
+                failed = g_SharedCmdBufs.value.init();
+                uint8_t client = 0;
+                ([&]{
+                    using EP = decltype(EPSelfContainedTypes::ep);
+                    if constexpr (EP::kSharedCmdBufs)
+                        EP::attach_cmd_bufs(g_SharedCmdBufs.value, client++);
+                }(), ...);
+            }
+            return failed + eps.init();
+        }
 
         operator zb_af_device_ctx_t*() { return &ctx; }
 
@@ -5,9 +5,121 @@
 #include "zb_desc_helper_types_ep.hpp"
 #include "lib_notification_node.hpp"
 #include "zb_str.hpp"
+#include <array>
+#include <algorithm>
 
 namespace zb
 {
+    /**********************************************************************/
+    /* Indexed registry of runtime handling nodes                         */
+    /**********************************************************************/
+    //Alternative to walking GenericNotificationNode<Node>::g_List with a fits() check per node:
+    //nodes (anything with an 'h' derived from ep_cluster_attribute_desc_t) are kept in a sorted array keyed
+    //on (ep, cluster, attr), so a lookup is a binary search. Nodes with wildcards are kept behind the exact ones
+    //and checked one by one. Registration order is kept among nodes with the same key and among wildcard nodes.
+    //Not to be modified from inside a handler.
+    //Node types are the indexed_*_handling_node_t ones: they never join a g_List, so a node is called once
+    template<class Node>
+    struct attr_handler_index_t
+    {
+        static_assert(!std::is_base_of_v<GenericNotificationNode<Node>, Node>, "A notification node is walked through its g_List already, use indexed_*_handling_node_t");
+
+        attr_handler_index_t(uint64_t *pKeys, Node **pNodes, size_t capacity):
+            m_pKeys(pKeys), m_pNodes(pNodes), m_Capacity(capacity)
+        {
+        }
+        attr_handler_index_t(attr_handler_index_t const&) = delete;
+        attr_handler_index_t& operator=(attr_handler_index_t const&) = delete;
+
+        //returns false if the registry is full
+        bool add(Node &n)
+        {
+            if (m_Count == m_Capacity)
+                return false;
+            size_t pos = m_Count;
+            if (n.h.is_exact())
+            {
+                pos = std::upper_bound(m_pKeys, m_pKeys + m_Exact, n.h.key()) - m_pKeys;
+                std::copy_backward(m_pKeys + pos, m_pKeys + m_Exact, m_pKeys + m_Exact + 1);
+                m_pKeys[pos] = n.h.key();
+                ++m_Exact;
+            }
+            std::copy_backward(m_pNodes + pos, m_pNodes + m_Count, m_pNodes + m_Count + 1);
+            m_pNodes[pos] = &n;
+            ++m_Count;
+            return true;
+        }
+
+        //returns false if the node was not registered
+        bool remove(Node &n)
+        {
+            size_t first = m_Exact, last = m_Count;
+            if (n.h.is_exact())
+            {
+                auto r = std::equal_range(m_pKeys, m_pKeys + m_Exact, n.h.key());
+                first = r.first - m_pKeys;
+                last = r.second - m_pKeys;
+            }
+            Node **pN = std::find(m_pNodes + first, m_pNodes + last, &n);
+            if (pN == m_pNodes + last)
+                return false;
+            size_t pos = pN - m_pNodes;
+            std::copy(m_pNodes + pos + 1, m_pNodes + m_Count, m_pNodes + pos);
+            if (pos < m_Exact)
+            {
+                std::copy(m_pKeys + pos + 1, m_pKeys + m_Exact, m_pKeys + pos);
+                --m_Exact;
+            }
+            --m_Count;
+            return true;
+        }
+
+        //calls f(Node&) for the nodes with the exact key first, then for the fitting wildcard ones
+        template<class F>
+        void for_each_fitting(zb_uint8_t ep, uint16_t cluster, uint16_t attr, F &&f) const
+        {
+            auto r = std::equal_range(m_pKeys, m_pKeys + m_Exact, ep_cluster_attribute_desc_t::make_key(ep, cluster, attr));
+            for(size_t i = r.first - m_pKeys, e = r.second - m_pKeys; i < e; ++i)
+                f(*m_pNodes[i]);
+            for(size_t i = m_Exact; i < m_Count; ++i)
+                if (m_pNodes[i]->h.fits(ep, cluster, attr))
+                    f(*m_pNodes[i]);
+        }
+
+        size_t size() const { return m_Count; }
+        size_t capacity() const { return m_Capacity; }
+    private:
+        uint64_t *m_pKeys;//keys of the exact nodes [0, m_Exact)
+        Node **m_pNodes;//[0, m_Exact) - exact, sorted; [m_Exact, m_Count) - wildcards
+        size_t m_Capacity;
+        size_t m_Exact = 0;
+        size_t m_Count = 0;
+    };
+
+    //the registry the tpl_*_cb callbacks consult for Node, see attr_handler_registry_t
+    template<class Node>
+    constinit inline attr_handler_index_t<Node> *g_pAttrHandlerIndex = nullptr;
+
+    //Storage for N nodes. Becomes the registry of Node on construction:
+    //zb::attr_handler_registry_t<zb::indexed_report_handling_node_t, 256> g_ReportHandlers;
+    //g_ReportHandlers.add(node);
+    template<class Node, size_t N>
+    struct attr_handler_registry_t: attr_handler_index_t<Node>
+    {
+        attr_handler_registry_t(): attr_handler_index_t<Node>(m_Keys, m_Nodes, N) { g_pAttrHandlerIndex<Node> = this; }
+        ~attr_handler_registry_t() { if (g_pAttrHandlerIndex<Node> == this) g_pAttrHandlerIndex<Node> = nullptr; }
+    private:
+        uint64_t m_Keys[N];
+        Node *m_Nodes[N];
+    };
+
+    template<class Node, class F>
+    void for_each_indexed_fitting(zb_uint8_t ep, uint16_t cluster, uint16_t attr, F &&f)
+    {
+        if (auto *pIndex = g_pAttrHandlerIndex<Node>)
+            pIndex->for_each_fitting(ep, cluster, attr, std::forward<F>(f));
+    }
+
     /**********************************************************************/
     /* Set Attribute value callback                                       */
     /**********************************************************************/
@@ -158,6 +270,12 @@ namespace zb
         set_attr_val_gen_desc_t h;
     };
 
+    //for attr_handler_registry_t
+    struct indexed_set_attr_val_handling_node_t
+    {
+        set_attr_val_gen_desc_t h;
+    };
+
     struct dev_cb_handlers_desc_t
     {
         dev_callback_handler_t default_handler = nullptr;
@@ -171,6 +289,109 @@ namespace zb
         void DoNotify(zb_zcl_device_callback_param_t *pDevParam) { h(pDevParam); }
     };
 
+    namespace internals
+    {
+        //Compile-time dispatch for set_attr_val_gen_desc_t handlers.
+        //Exact (ep, cluster, attr) keys are sorted (so grouped by ep, then cluster, then attribute) and each key
+        //gets the list of all the handlers fitting it, wildcard ones merged in, in declaration order.
+        //A write is resolved with a binary search over the keys; only writes without an exact key
+        //check the wildcard handlers one by one.
+        template<set_attr_val_gen_desc_t... handlers>
+        struct set_attr_dispatch_t
+        {
+            using desc_t = set_attr_val_gen_desc_t;
+            static constexpr size_t N = sizeof...(handlers);
+            static constexpr std::array<desc_t, N> kHandlers{handlers...};
+
+            struct keys_t
+            {
+                std::array<uint64_t, N> keys{};
+                size_t count = 0;
+            };
+
+            static constexpr keys_t exact_keys()
+            {
+                keys_t r;
+                for(desc_t const& h : kHandlers)
+                    if (h.is_exact())
+                        r.keys[r.count++] = h.key();
+                std::sort(r.keys.begin(), r.keys.begin() + r.count);
+                r.count = std::unique(r.keys.begin(), r.keys.begin() + r.count) - r.keys.begin();
+                return r;
+            }
+            static constexpr keys_t kExact = exact_keys();
+            static constexpr size_t kKeys = kExact.count;
+
+            static constexpr bool fits(desc_t const& h, uint64_t k) { return h.fits(zb_uint8_t(k >> 32), uint16_t(k >> 16), uint16_t(k)); }
+
+            static constexpr size_t count_entries()
+            {
+                size_t n = 0;
+                for(size_t k = 0; k < kKeys; ++k)
+                    for(desc_t const& h : kHandlers)
+                        n += fits(h, kExact.keys[k]);
+                return n;
+            }
+            static constexpr size_t count_wildcards()
+            {
+                size_t n = 0;
+                for(desc_t const& h : kHandlers)
+                    n += !h.is_exact();
+                return n;
+            }
+            static constexpr size_t kEntries = count_entries();
+            static constexpr size_t kWildcards = count_wildcards();
+
+            struct table_t
+            {
+                std::array<uint64_t, kKeys> keys{};
+                std::array<uint16_t, kKeys + 1> first{};//handlers of keys[k] are entries[first[k]..first[k+1])
+                std::array<set_attr_value_handler_t, kEntries> entries{};
+                std::array<desc_t, kWildcards> wildcards{};
+            };
+
+            static constexpr table_t build()
+            {
+                table_t t;
+                size_t e = 0;
+                for(size_t k = 0; k < kKeys; ++k)
+                {
+                    t.keys[k] = kExact.keys[k];
+                    t.first[k] = uint16_t(e);
+                    for(desc_t const& h : kHandlers)
+                        if (fits(h, t.keys[k]))
+                            t.entries[e++] = h.handler;
+                }
+                t.first[kKeys] = uint16_t(e);
+                size_t w = 0;
+                for(desc_t const& h : kHandlers)
+                    if (!h.is_exact())
+                        t.wildcards[w++] = h;
+                return t;
+            }
+            static constexpr table_t kTable = build();
+
+            static void dispatch(zb_uint8_t ep, zb_zcl_set_attr_value_param_t *pSetVal, zb_zcl_device_callback_param_t *pDevParam)
+            {
+                if constexpr (kKeys > 0)
+                {
+                    const uint64_t k = desc_t::make_key(ep, pSetVal->cluster_id, pSetVal->attr_id);
+                    auto it = std::lower_bound(kTable.keys.begin(), kTable.keys.end(), k);
+                    if (it != kTable.keys.end() && *it == k)
+                    {
+                        size_t i = it - kTable.keys.begin();
+                        for(size_t e = kTable.first[i]; e < kTable.first[i + 1]; ++e)
+                            kTable.entries[e](pSetVal, pDevParam);
+                        return;
+                    }
+                }
+                for(desc_t const& h : kTable.wildcards)
+                    if (h.fits(ep, pSetVal->cluster_id, pSetVal->attr_id))
+                        h.handler(pSetVal, pDevParam);
+            }
+        };
+    }
+
     template<dev_cb_handlers_desc_t generic={}, set_attr_val_gen_desc_t... handlers>
     void tpl_device_cb(zb_bufid_t bufid)
     {
@@ -191,14 +412,7 @@ namespace zb
                     if constexpr (sizeof...(handlers))
                     {
                         static_assert(((handlers.handler != nullptr) && ...), "Invalid handler detected");
-                        auto f = [&](const zb::set_attr_val_gen_desc_t &h)
-                        {
-                            if (h.fits(pDevParam->endpoint, pSetVal->cluster_id, pSetVal->attr_id))
-                                h.handler(pSetVal, pDevParam);
-                        };
-                        (f(handlers),...);
-                        //[[maybe_unused]]zb_ret_t r = 
-                        //    ((handlers.fits(pDevParam->endpoint, pSetVal->cluster_id, pSetVal->attr_id) ? handlers.handler(pSetVal, pDevParam), RET_OK : RET_OK), ...);
+                        internals::set_attr_dispatch_t<handlers...>::dispatch(pDevParam->endpoint, pSetVal, pDevParam);
                     }
 
                     for(auto *pN : set_attr_val_handling_node_t::g_List)
@@ -212,6 +426,9 @@ namespace zb
                         if (pN->h.fits(pDevParam->endpoint, pSetVal->cluster_id, pSetVal->attr_id))
                             pN->h.handler(pSetVal, pDevParam);
                     }
+
+                    for_each_indexed_fitting<indexed_set_attr_val_handling_node_t>(pDevParam->endpoint, pSetVal->cluster_id, pSetVal->attr_id,
+                            [&](indexed_set_attr_val_handling_node_t &n){ n.h.handler(pSetVal, pDevParam); });
                 }
                 break;
             default:
@@ -246,6 +463,12 @@ namespace zb
         no_report_attr_handler_desc_t h;
     };
 
+    //for attr_handler_registry_t
+    struct indexed_no_report_handling_node_t
+    {
+        no_report_attr_handler_desc_t h;
+    };
+
     template<no_report_attr_handler_desc_t... handlers>
     void tpl_no_report_cb(zb_uint8_t ep, zb_uint16_t cluster_id, zb_uint16_t attr_id)
     {
@@ -261,6 +484,9 @@ namespace zb
             if (pN->h.fits(ep, cluster_id, attr_id))
                 pN->h.handler(ep, cluster_id, attr_id);
         }
+
+        for_each_indexed_fitting<indexed_no_report_handling_node_t>(ep, cluster_id, attr_id,
+                [&](indexed_no_report_handling_node_t &n){ n.h.handler(ep, cluster_id, attr_id); });
     }
 
     /**********************************************************************/
@@ -276,6 +502,12 @@ namespace zb
         report_attr_handler_desc_t h;
     };
 
+    //for attr_handler_registry_t
+    struct indexed_report_handling_node_t
+    {
+        report_attr_handler_desc_t h;
+    };
+
     template<class T> requires (std::is_integral_v<T> && std::is_signed_v<T>)
     const T& get_typed_data(zb_uint8_t attr_type, zb_uint8_t *value)
     {
@@ -405,6 +637,9 @@ namespace zb
             if (pN->h.fits(ep, cluster_id, attr_id))
                 pN->h.handler(addr, ep, cluster_id, attr_id, attr_type, value);
         }
+
+        for_each_indexed_fitting<indexed_report_handling_node_t>(ep, cluster_id, attr_id,
+                [&](indexed_report_handling_node_t &n){ n.h.handler(addr, ep, cluster_id, attr_id, attr_type, value); });
     }
 }
 #endif
@@ -5,6 +5,11 @@
 #include <zephyr/drivers/adc.h>
 #include <zephyr/drivers/regulator.h>
 #include "zb_power_config_cluster_desc.hpp"
+#include "zb_alarm.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <initializer_list>
 
 namespace zb
 {
@@ -16,16 +21,83 @@ namespace zb
         const struct device *pDev;
     };
 
+    struct battery_curve_point_t
+    {
+        uint16_t mv;//per cell
+        uint8_t pct;//0-100
+    };
+
+    //discharge curve: points sorted by voltage, percentages non-decreasing
+    struct battery_curve_t
+    {
+        static constexpr size_t kMaxPoints = 12;
+        battery_curve_point_t points[kMaxPoints] = {};
+        uint8_t count = 0;//0 - linear between minBatteryVoltage and maxBatteryVoltage
+
+        constexpr bool valid() const
+        {
+            if (count == 1 || count > kMaxPoints)
+                return false;
+            for(size_t i = 1; i < count; ++i)
+                if (points[i].mv <= points[i - 1].mv || points[i].pct < points[i - 1].pct || points[i].pct > 100)
+                    return false;
+            return true;
+        }
+    };
+
+    consteval battery_curve_t make_battery_curve(std::initializer_list<battery_curve_point_t> pts)
+    {
+        battery_curve_t c;
+        for(auto p : pts)
+        {
+            if (c.count < battery_curve_t::kMaxPoints)
+                c.points[c.count] = p;
+            ++c.count;
+        }
+        return c;
+    }
+
+    //typical curves under a light load, per cell
+    namespace battery_curves
+    {
+        inline constexpr battery_curve_t kAlkaline = make_battery_curve({
+                {900, 0}, {1000, 2}, {1100, 8}, {1170, 18}, {1230, 30}, {1290, 45}, {1350, 60}, {1420, 75}, {1500, 90}, {1580, 100}
+                });
+        //flat for most of the capacity, then a cliff
+        inline constexpr battery_curve_t kLiSOCl2 = make_battery_curve({
+                {2800, 0}, {3000, 1}, {3200, 5}, {3300, 12}, {3400, 25}, {3450, 40}, {3500, 60}, {3550, 80}, {3600, 95}, {3650, 100}
+                });
+        inline constexpr battery_curve_t kNiMH = make_battery_curve({
+                {950, 0}, {1050, 2}, {1130, 8}, {1180, 18}, {1210, 30}, {1230, 45}, {1250, 60}, {1270, 75}, {1320, 90}, {1400, 100}
+                });
+    }
+
     struct battery_cfg_t
     {
         int battery_adc_channel = 0;
         int32_t maxBatteryVoltage = 1600;//mV
         int32_t minBatteryVoltage = 900;//mV
+        //true: update() never blocks the ZBOSS thread. The regulator settle delay is a zb_alarm_t,
+        //the ADC is read from the system work queue and the attributes are updated back on the ZBOSS thread
+        bool async = false;
+        uint8_t samples = 1;//samples taken in one adc_sequence (extra_samplings) and averaged
+        uint8_t oversampling = 0;//hardware oversampling (2^n conversions per sample), 0 - as configured in the devicetree
+        uint16_t settle_ms = 0;//delay between enabling the regulator and sampling, needs async
+        battery_curve_t curve = {};//voltage -> percentage, see battery_curves::
+        uint8_t cells = 1;//cells in series, curve voltages are multiplied by it
+        //battery alarms (only if the EP declares zb_zcl_power_cfg_battery_settings_t):
+        //an alarm clears once the value rises above its threshold by more than the hysteresis
+        uint8_t alarm_voltage_hysteresis = 1;//100mV units, as batt_voltage
+        uint8_t alarm_percentage_hysteresis = 2;//1% units, as batt_percentage thresholds
     };
 
     template<battery_cfg_t cfg, class EP>
     struct battery_measurements_block_t
     {
+        static_assert(cfg.samples > 0, "At least 1 sample is required");
+        static_assert(cfg.curve.valid(), "Invalid discharge curve: 2 to kMaxPoints points sorted by voltage, percentages non-decreasing up to 100");
+        static_assert(cfg.cells > 0, "At least 1 cell is required");
+        static_assert(cfg.async || cfg.settle_ms == 0, "settle_ms needs async = true: the sync update() runs on the ZBOSS thread and must not sleep");
         static const constexpr auto kAttrBattVoltage = &zb::zb_zcl_power_cfg_battery_info_t::batt_voltage;
         static const constexpr auto kAttrBattPercentage = &zb::zb_zcl_power_cfg_battery_info_t::batt_percentage_remaining;
         static const constexpr int32_t g_BatteryVoltageRange = cfg.maxBatteryVoltage - cfg.minBatteryVoltage;//mV
@@ -35,28 +107,266 @@ namespace zb
         const struct adc_dt_spec *adc_channels;
         const struct device *regulator;
 
-        void update()
+        //async mode state
+        zb_alarm_t settle_alarm{};
+        struct k_work work{};
+        int32_t result_mv = 0;
+        int result_err = 0;
+        std::atomic<bool> busy{false};//set on the ZBOSS thread, may be cleared from the work queue
+
+        //blocking, averages cfg.samples samples; mV in 'mv'
+        int measure(int32_t &mv)
         {
-            reg_raii_t batteryRegulator(regulator);
-            uint16_t buf;
+            const struct adc_dt_spec *pSpec = &adc_channels[cfg.battery_adc_channel];
+            uint16_t buf[cfg.samples];
+            struct adc_sequence_options opts = {};
+            opts.extra_samplings = cfg.samples - 1;
             struct adc_sequence sequence = {
-                .buffer = &buf,
+                .options = cfg.samples > 1 ? &opts : nullptr,
+                .buffer = buf,
                 /* buffer size in bytes, not number of samples */
                 .buffer_size = sizeof(buf),
             };
-            (void)adc_sequence_init_dt(&adc_channels[cfg.battery_adc_channel], &sequence);
+            (void)adc_sequence_init_dt(pSpec, &sequence);
+            if constexpr (cfg.oversampling != 0)
+                sequence.oversampling = cfg.oversampling;
 
-            int err = adc_read_dt(&adc_channels[cfg.battery_adc_channel], &sequence);
-            if (err == 0)
+            int err = adc_read_dt(pSpec, &sequence);
+            if (err != 0)
+                return err;
+
+            int32_t sum = 0;
+            for(uint16_t s : buf)
+                sum += s;
+            mv = (sum + cfg.samples / 2) / cfg.samples;
+            return adc_raw_to_millivolts_dt(pSpec, &mv);
+        }
+
+        //the curve as Q16 fixed point segments, computed at compile time
+        struct curve_segment_t
+        {
+            int32_t mv;
+            int32_t half_pct_q16;//ZCL units: 0.5%
+            int32_t slope_q16;//half percents per mV
+        };
+        static constexpr size_t kSegments = cfg.curve.count ? cfg.curve.count - 1 : 0;
+        static constexpr std::array<curve_segment_t, kSegments> make_curve_lut()
+        {
+            std::array<curve_segment_t, kSegments> lut{};
+            for(size_t i = 0; i < kSegments; ++i)
             {
-                int32_t batteryVoltage = (int32_t)buf;
-                adc_raw_to_millivolts_dt(&adc_channels[cfg.battery_adc_channel],
-                        &batteryVoltage);
+                auto p0 = cfg.curve.points[i], p1 = cfg.curve.points[i + 1];
+                int32_t dmv = (p1.mv - p0.mv) * cfg.cells;
+                lut[i] = {
+                    .mv = p0.mv * cfg.cells,
+                    .half_pct_q16 = (p0.pct * 2) << 16,
+                    .slope_q16 = (((p1.pct - p0.pct) * 2) << 16) / dmv
+                };
+            }
+            return lut;
+        }
+        static constexpr std::array<curve_segment_t, kSegments> kCurveLut = make_curve_lut();
 
-                printk("update_battery_state_zb: volt %d\r\n", batteryVoltage);
-                zb_ep.template attr<kAttrBattVoltage>() = uint8_t(batteryVoltage / 100);
-                zb_ep.template attr<kAttrBattPercentage>() = uint8_t((batteryVoltage - cfg.minBatteryVoltage) * 200 / g_BatteryVoltageRange);
+        //mV -> batt_percentage_remaining (0-200), clamped
+        static constexpr uint8_t voltage_to_percentage(int32_t mv)
+        {
+            if constexpr (kSegments == 0)
+            {
+                if (mv <= cfg.minBatteryVoltage)
+                    return 0;
+                if (mv >= cfg.maxBatteryVoltage)
+                    return 200;
+                return uint8_t((mv - cfg.minBatteryVoltage) * 200 / g_BatteryVoltageRange);
             }
+            else
+            {
+                constexpr auto kLast = cfg.curve.points[cfg.curve.count - 1];
+                if (mv >= kLast.mv * cfg.cells)
+                    return kLast.pct * 2;
+                if (mv <= kCurveLut[0].mv)
+                    return uint8_t(kCurveLut[0].half_pct_q16 >> 16);
+                size_t i = kSegments - 1;
+                while(mv < kCurveLut[i].mv)
+                    --i;
+                auto const& s = kCurveLut[i];
+                return uint8_t((s.half_pct_q16 + (mv - s.mv) * s.slope_q16 + (1 << 15)) >> 16);
+            }
+        }
+
+        //battery alarms, see evaluate_alarms
+        using battery_settings_t = zb_zcl_power_cfg_battery_settings_t;
+        static const constexpr auto kAttrAlarmState = &battery_settings_t::batt_alarm_state;
+        static const constexpr auto kAttrAlarmMask = &battery_settings_t::batt_alarm_mask;
+        static constexpr bool kHasAlarms = EP::template has_attr<kAttrAlarmState>();
+        static constexpr uint8_t kAlarmBits = 0x0f;//min threshold, threshold1..3 of the battery source 1
+        static constexpr uint8_t kAlarmCodeSrc1 = 0x10;//+ bit: BatteryVoltage/PercentageMinThreshold, Threshold1..3
+        static constexpr uint8_t kAlarmCmdId = 0x00;//Alarms cluster: Alarm (server -> client)
+        uint8_t voltage_alarms = 0;//latched, bit per threshold as in batt_alarm_state
+        uint8_t percentage_alarms = 0;
+        uint8_t active_alarms = 0;
+
+        //sets the bit when the value drops to the threshold, clears it only when the value
+        //exceeds the threshold by more than 'hyst'. Threshold 0 or 0xff - not used
+        static constexpr uint8_t latch_alarms(uint8_t latched, uint16_t v, std::array<uint16_t, 4> thresholds, uint16_t hyst)
+        {
+            for(uint8_t b = 0; b < thresholds.size(); ++b)
+            {
+                const uint16_t t = thresholds[b];
+                const uint8_t bit = 1 << b;
+                if (t == 0)
+                    latched &= ~bit;
+                else if (v <= t)
+                    latched |= bit;
+                else if (v > t + hyst)
+                    latched &= ~bit;
+            }
+            return latched;
+        }
+
+        template<auto memPtr>
+        uint16_t threshold(uint16_t scale)
+        {
+            uint8_t t = zb_ep.template attr_storage<memPtr>();
+            return t == 0xff ? 0 : t * scale;
+        }
+
+        //runs after each measurement; batt_alarm_state is only written when it changes,
+        //an Alarm notification is sent (to the bound devices) for each newly raised alarm allowed by batt_alarm_mask
+        void evaluate_alarms(uint8_t voltage, uint8_t percentage)
+        {
+            using S = battery_settings_t;
+            voltage_alarms = latch_alarms(voltage_alarms, voltage, {
+                    threshold<&S::batt_voltage_min_threshold>(1),
+                    threshold<&S::batt_voltage_threshold1>(1),
+                    threshold<&S::batt_voltage_threshold2>(1),
+                    threshold<&S::batt_voltage_threshold3>(1)
+                    }, cfg.alarm_voltage_hysteresis);
+            //thresholds are in 1%, batt_percentage_remaining is in 0.5%
+            percentage_alarms = latch_alarms(percentage_alarms, percentage, {
+                    threshold<&S::batt_percentage_min_threshold>(2),
+                    threshold<&S::batt_percentage_threshold1>(2),
+                    threshold<&S::batt_percentage_threshold2>(2),
+                    threshold<&S::batt_percentage_threshold3>(2)
+                    }, cfg.alarm_percentage_hysteresis * 2);
+
+            const uint8_t active = voltage_alarms | percentage_alarms;
+            const uint32_t state = std::bit_cast<uint32_t>(zb_ep.template attr_storage<kAttrAlarmState>());
+            const uint32_t new_state = (state & ~uint32_t(kAlarmBits)) | active;
+            if (new_state != state)
+                zb_ep.template attr<kAttrAlarmState>() = std::bit_cast<zb_battery_alarm_state_t>(new_state);
+
+            const uint8_t raised = active & ~active_alarms & std::bit_cast<uint8_t>(zb_ep.template attr_storage<kAttrAlarmMask>());
+            active_alarms = active;
+            for(uint8_t b = 0; b < 4; ++b)
+            {
+                if (raised & (1 << b))
+                    zb_buf_get_out_delayed_ext(send_alarm, kAlarmCodeSrc1 + b, 0);
+            }
+        }
+
+        static void send_alarm(zb_bufid_t b, zb_uint16_t code)
+        {
+            if (!g_Battery)
+            {
+                zb_buf_free(b);
+                return;
+            }
+            frame_ctl_t f{.f{
+                .cluster_specific = true,
+                    .manufacture_specific = false,
+                    .direction = frame_direction_t::ToClient,
+                    .disable_default_response = true
+            }};
+            const uint8_t ep = g_Battery->zb_ep.ep.ep_id;
+            ZB_ZCL_GET_SEQ_NUM();
+            uint8_t* ptr = (uint8_t*)zb_zcl_start_command_header(b, f.u8, ZB_ZCL_MANUF_CODE_INVALID, kAlarmCmdId, nullptr);
+            *ptr++ = uint8_t(code);
+            *ptr++ = uint8_t(kZB_ZCL_CLUSTER_ID_POWER_CFG & 0xff);
+            *ptr++ = uint8_t(kZB_ZCL_CLUSTER_ID_POWER_CFG >> 8);
+            zb_addr_u addr{.addr_short = 0};
+            if (zb_zcl_finish_and_send_packet(b, ptr, &addr, ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT, 0, ep, ZB_AF_HA_PROFILE_ID, ZB_ZCL_CLUSTER_ID_ALARMS, nullptr) != RET_OK)
+                zb_buf_free(b);
+        }
+
+        void apply(int32_t batteryVoltage)
+        {
+            const uint8_t voltage = uint8_t(batteryVoltage / 100);
+            const uint8_t percentage = voltage_to_percentage(batteryVoltage);
+            zb_ep.template attr<kAttrBattVoltage>() = voltage;
+            zb_ep.template attr<kAttrBattPercentage>() = percentage;
+            if constexpr (kHasAlarms)
+                evaluate_alarms(voltage, percentage);
+        }
+
+        void update()
+        {
+            if constexpr (cfg.async)
+                update_async();
+            else
+            {
+                reg_raii_t batteryRegulator(regulator);
+                int32_t batteryVoltage;
+                if (measure(batteryVoltage) == 0)
+                {
+                    printk("update_battery_state_zb: volt %d\r\n", batteryVoltage);
+                    apply(batteryVoltage);
+                }
+            }
+        }
+
+        //ZBOSS thread: enable the regulator and let it settle without blocking
+        void update_async()
+        {
+            if (busy.exchange(true, std::memory_order_acquire))//the previous measurement is still in progress
+                return;
+            if (regulator)
+                regulator_enable(regulator);
+            if constexpr (cfg.settle_ms != 0)
+            {
+                if (settle_alarm.Setup(&on_settled, this, cfg.settle_ms) != RET_OK)
+                {
+                    //measuring right away would read an unsettled voltage: skip this one, the next update() starts over
+                    //(Cancel: a request that failed to wake the ZBOSS thread up may still be applied later)
+                    settle_alarm.Cancel();
+                    if (regulator)
+                        regulator_disable(regulator);
+                    busy.store(false, std::memory_order_release);
+                }
+                return;
+            }
+            on_settled(this);
+        }
+
+        static void on_settled(void *p)
+        {
+            auto *pThis = static_cast<battery_measurements_block_t*>(p);
+            if (k_work_submit(&pThis->work) < 0)
+            {
+                //nothing will read it: skip this one, the next update() starts over
+                if (pThis->regulator)
+                    regulator_disable(pThis->regulator);
+                pThis->busy.store(false, std::memory_order_release);
+            }
+        }
+
+        //system work queue: the blocking ADC read
+        static void on_work(struct k_work *)
+        {
+            auto *pThis = g_Battery;
+            pThis->result_err = pThis->measure(pThis->result_mv);
+            if (pThis->regulator)
+                regulator_disable(pThis->regulator);
+            if (zigbee_schedule_callback(on_measured_zb, 0) != RET_OK)
+                pThis->busy.store(false, std::memory_order_release);//dropped, the next update() starts over
+        }
+
+        //back on the ZBOSS thread
+        static void on_measured_zb(uint8_t)
+        {
+            auto *pThis = g_Battery;
+            pThis->busy.store(false, std::memory_order_release);
+            if (pThis->result_err == 0)
+                pThis->apply(pThis->result_mv);
         }
 
         static void update_zb_callback(uint8_t dummy)
@@ -81,6 +391,8 @@ namespace zb
                 printk("Could not setup channel #%d (%d)\n", 0, err);
                 return err;
             }
+            if constexpr (cfg.async)
+                k_work_init(&work, on_work);
             return 0;
         }
     };
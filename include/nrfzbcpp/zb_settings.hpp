@@ -2,7 +2,15 @@
 #define ZB_SETTINGS_HPP_
 
 #include "zb_handlers.hpp"
+#include "zb_alarm.hpp"
 #include "zephyr/settings/settings.h"
+#include "zephyr/sys/crc.h"
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <algorithm>
+#include <string_view>
 
 namespace zb
 {
@@ -23,16 +31,45 @@ namespace zb
             settings_save_one(entry.name, &entry.mem, sizeof(std::remove_cvref_t<decltype(entry.mem)>));
         }
 
-    template<size_t off, auto... entries>
+    struct settings_cfg_t
+    {
+        size_t off = 0;//length of the subtree prefix in the entry names ("zigbee/" - 7)
+        //0 - every attribute write is saved right away
+        //otherwise writes only mark the entries dirty and all of them are saved in one batch
+        //write_behind_ms after the last write (but no later than write_behind_max_ms after the first one)
+        uint32_t write_behind_ms = 0;
+        uint32_t write_behind_max_ms = 0;//0 - 4 x write_behind_ms
+        //non-null (full name, e.g. "zigbee/cfg"): all the entries are stored as one blob under this name
+        //(one read at boot, one write per save). The blob carries a CRC and the layout (names and sizes of the entries),
+        //so a blob of another firmware version is migrated field by field
+        const char *blob_name = nullptr;
+        size_t blob_capacity = 0;//bytes to read a blob of an older, larger layout (a larger one is cut to it); 0 - size of the current layout
+    };
+
+    //persistent_settings_manager_t<7, entries...> is the same as persistent_settings_manager_t<settings_cfg_t{.off = 7}, entries...>
+    template<auto cfg, auto... entries>
         struct persistent_settings_manager_t
         {
+            static constexpr settings_cfg_t kCfg = [](){
+                if constexpr (std::is_integral_v<decltype(cfg)>)
+                    return settings_cfg_t{.off = size_t(cfg)};
+                else
+                    return settings_cfg_t(cfg);
+            }();
+            static constexpr size_t off = kCfg.off;
+            static constexpr bool kWriteBehind = kCfg.write_behind_ms != 0;
+            static constexpr uint32_t kWriteBehindMaxMs = kCfg.write_behind_max_ms ? kCfg.write_behind_max_ms : kCfg.write_behind_ms * 4;
+            static_assert(!kWriteBehind || kWriteBehindMaxMs >= kCfg.write_behind_ms, "write_behind_max_ms can't be less than write_behind_ms");
+            static constexpr bool kBlob = kCfg.blob_name != nullptr;
+
             static int zigbee_settings_export(int (*cb)(const char *name,
                                                        const void *value, size_t val_len))
             {
+                if constexpr (kBlob)
+                    return cb(kCfg.blob_name, g_Blob.data(), serialize_blob());
                 int rc = 0;
                 auto export_entry = [&](auto e){
                     if (rc < 0) return;
-                    const char *next;
                     using T = std::remove_cvref_t<decltype(e.mem)>;
                     rc = cb(e.name, &e.mem, sizeof(T));
                 };
@@ -41,57 +78,365 @@ namespace zb
                 return rc;
             }
 
+            //one hash and one compare per loaded key: entry names (without the 'off' prefix) are put into
+            //an open-addressing table at compile time
             static int zigbee_settings_set(const char *name, size_t len,
                     settings_read_cb read_cb, void *cb_arg)
             {
-                int rc;
-                bool found = false;
-                auto process_entry = [&](auto e){
-                    if (found) return;
-                    const char *next;
-                    if (settings_name_steq(name, e.name + off, &next) && !next) {
-                        using T = std::remove_cvref_t<decltype(e.mem)>;
-                        found = true;
-                        if (len != sizeof(T)) {
-                            rc = -EINVAL;
-                            return;
-                        }
-                        rc = read_cb(cb_arg, &e.mem, sizeof(T));
-                        if (rc >= 0)
+                const char *next;
+                if constexpr (kBlob)
+                {
+                    if (settings_name_steq(name, kCfg.blob_name + off, &next) && !next)
+                        return load_blob(len, read_cb, cb_arg);
+                }
+                for(size_t c = name_hash(name) & kNameTableMask; kNameTable[c] != kNoEntry; c = (c + 1) & kNameTableMask)
+                {
+                    size_t i = kNameTable[c];
+                    if (settings_name_steq(name, kNames[i], &next) && !next)
+                    {
+                        if constexpr (kBlob)
                         {
-                            if (rc != sizeof(T))
-                                rc = -EINVAL;
-                            else
-                                rc = 0;//we've read the correct size
-                            return;
+                            //stored by a firmware without the blob: taken over (unless a valid blob has been loaded already,
+                            //that one is newer) and removed with the first blob save
+                            g_LegacyKeys = true;
+                            g_BlobStale = true;
+                            if (g_BlobLoaded)
+                                return 0;
                         }
+                        return kReaders[i](len, read_cb, cb_arg);
                     }
-                };
+                }
+                return -ENOENT;
+            }
 
-                (process_entry(entries),...);
-                return !found ? -ENOENT : rc;
+            //h_commit of the settings handler: saves the blob if it was loaded from another layout
+            //or assembled from per-entry keys
+            static int zigbee_settings_commit()
+            {
+                if constexpr (kBlob)
+                {
+                    if (g_BlobStale)
+                        return save_blob();
+                }
+                return 0;
             }
 
-            template<zb::set_attr_value_handler_t h>
+            //With write_behind_ms changes reach flash only when the batch is saved, so flush() must run before the device
+            //powers off or leaves the network: pass it as sig_handlers_t::flush_settings (called on ZB_SIGNAL_READY_TO_SHUT
+            //and ZB_ZDO_SIGNAL_LEAVE) or call it from there. Waits for a batch queued or being saved on the work queue,
+            //then saves what's left on the calling thread. Entries whose save failed stay unsaved (see has_unsaved())
+            static void flush()
+            {
+                if constexpr (kWriteBehind)
+                {
+                    g_FlushAlarm.Cancel();
+                    struct k_work_sync sync;
+                    k_work_flush(&g_SaveWork, &sync);
+                    save_dirty();
+                }
+            }
+
+            static bool has_unsaved()
+            {
+                for(auto const& w : g_Dirty)
+                    if (w.load(std::memory_order_relaxed))
+                        return true;
+                return false;
+            }
+
+            template<size_t idx, zb::set_attr_value_handler_t h = nullptr>
+                static void on_setting_changed_deferred(zb_zcl_set_attr_value_param_t *p, zb_zcl_device_callback_param_t *pDevCBParam)
+                {
+                    if constexpr (h != nullptr)
+                        h(p, pDevCBParam);
+                    mark_dirty(idx);
+                }
+
+            template<zb::set_attr_value_handler_t h = nullptr>
+                static void on_setting_changed_blob(zb_zcl_set_attr_value_param_t *p, zb_zcl_device_callback_param_t *pDevCBParam)
+                {
+                    if constexpr (h != nullptr)
+                        h(p, pDevCBParam);
+                    save_blob();
+                }
+
+            template<zb::set_attr_value_handler_t h, size_t idx = 0>
                 static constexpr zb::set_attr_value_handler_t find_recursive(const char *name)
                 {
                     return nullptr;
                 }
 
-            template<zb::set_attr_value_handler_t h, auto e, auto... rest>
+            template<zb::set_attr_value_handler_t h, size_t idx = 0, auto e, auto... rest>
                 static constexpr zb::set_attr_value_handler_t find_recursive(const char *name)
                 {
-                    if (e.name == name)
-                        return &on_setting_changed<e, h>;
+                    if (std::string_view(e.name) == std::string_view(name))
+                    {
+                        if constexpr (kWriteBehind)
+                            return &on_setting_changed_deferred<idx, h>;
+                        else if constexpr (kBlob)
+                            return &on_setting_changed_blob<h>;
+                        else
+                            return &on_setting_changed<e, h>;
+                    }
                     else
-                        return find_recursive<h, rest...>(name);
+                        return find_recursive<h, idx + 1, rest...>(name);
                 }
 
             template<zb::set_attr_value_handler_t h>
                 static constexpr zb::set_attr_value_handler_t make_on_changed(const char *name)
                 {
-                    return find_recursive<h, entries...>(name);
+                    return find_recursive<h, 0, entries...>(name);
+                }
+
+        private:
+            //FNV-1a, stops where settings_name_steq stops comparing
+            static constexpr uint32_t name_hash(const char *name)
+            {
+                uint32_t h = 2166136261u;
+                for(; *name && *name != '='; ++name)
+                    h = (h ^ uint8_t(*name)) * 16777619u;
+                return h;
+            }
+
+            template<auto e>
+            static int read_entry(size_t len, settings_read_cb read_cb, void *cb_arg)
+            {
+                using T = std::remove_cvref_t<decltype(e.mem)>;
+                if (len != sizeof(T))
+                    return -EINVAL;
+                int rc = read_cb(cb_arg, &e.mem, sizeof(T));
+                if (rc < 0)
+                    return rc;
+                return rc == sizeof(T) ? 0 : -EINVAL;//we've read the correct size
+            }
+
+            using reader_t = int(*)(size_t len, settings_read_cb read_cb, void *cb_arg);
+            static constexpr size_t kEntries = sizeof...(entries);
+            static constexpr uint8_t kNoEntry = 0xff;
+            static_assert(kEntries < kNoEntry, "Too many settings entries");
+            static constexpr size_t kNameTableSize = std::bit_ceil(std::max(kEntries * 2, size_t(2)));
+            static constexpr size_t kNameTableMask = kNameTableSize - 1;
+            static constexpr std::array<const char*, kEntries> kNames{(entries.name + off)...};
+            static constexpr std::array<reader_t, kEntries> kReaders{&read_entry<entries>...};
+
+            static constexpr std::array<uint8_t, kNameTableSize> make_name_table()
+            {
+                std::array<uint8_t, kNameTableSize> t{};
+                t.fill(kNoEntry);
+                for(size_t i = 0; i < kEntries; ++i)
+                {
+                    size_t c = name_hash(kNames[i]) & kNameTableMask;
+                    while(t[c] != kNoEntry)
+                        c = (c + 1) & kNameTableMask;
+                    t[c] = uint8_t(i);
+                }
+                return t;
+            }
+            //entry names must be constexpr char arrays
+            static constexpr std::array<uint8_t, kNameTableSize> kNameTable = make_name_table();
+
+            /**********************************************************************/
+            /* Blob: header, {name hash, size} per entry, entry data              */
+            /**********************************************************************/
+            static constexpr uint8_t kBlobFormat = 1;
+            struct blob_header_t
+            {
+                uint8_t format;
+                uint8_t reserved;
+                uint16_t fields;
+                uint32_t layout_hash;
+                uint32_t crc;//of everything after the header
+            };
+            static constexpr size_t kBlobFieldSize = sizeof(uint32_t) + sizeof(uint16_t);
+            static constexpr std::array<uint32_t, kEntries> kHashes{name_hash(entries.name + off)...};
+            static constexpr std::array<uint16_t, kEntries> kSizes{uint16_t(sizeof(std::remove_cvref_t<decltype(entries.mem)>))...};
+            static constexpr std::array<void*, kEntries> kMems{static_cast<void*>(&entries.mem)...};
+            static constexpr size_t kBlobSize = sizeof(blob_header_t) + kEntries * kBlobFieldSize + (sizeof(std::remove_cvref_t<decltype(entries.mem)>) + ... + 0);
+            static constexpr size_t kBlobCapacity = std::max(kCfg.blob_capacity, kBlobSize);
+
+            static constexpr uint32_t layout_hash()
+            {
+                uint32_t h = 2166136261u;
+                for(size_t i = 0; i < kEntries; ++i)
+                    h = (h ^ kHashes[i]) * 16777619u ^ kSizes[i];
+                return h * 16777619u;
+            }
+            static constexpr uint32_t kLayoutHash = layout_hash();
+
+            static constexpr bool unique_hashes()
+            {
+                for(size_t i = 0; i < kEntries; ++i)
+                    for(size_t j = i + 1; j < kEntries; ++j)
+                        if (kHashes[i] == kHashes[j])
+                            return false;
+                return true;
+            }
+            //blob fields are matched by the name hash alone
+            static_assert(!kBlob || unique_hashes(), "Two settings entry names have the same hash, rename one of them");
+
+            static constexpr size_t find_by_hash(uint32_t h)
+            {
+                for(size_t c = h & kNameTableMask; kNameTable[c] != kNoEntry; c = (c + 1) & kNameTableMask)
+                    if (kHashes[kNameTable[c]] == h)
+                        return kNameTable[c];
+                return kNoEntry;
+            }
+
+            //returns the size of the blob in g_Blob
+            static size_t serialize_blob()
+            {
+                uint8_t *p = g_Blob.data() + sizeof(blob_header_t);
+                for(size_t i = 0; i < kEntries; ++i)
+                {
+                    std::memcpy(p, &kHashes[i], sizeof(uint32_t));
+                    std::memcpy(p + sizeof(uint32_t), &kSizes[i], sizeof(uint16_t));
+                    p += kBlobFieldSize;
+                }
+                for(size_t i = 0; i < kEntries; ++i)
+                {
+                    std::memcpy(p, kMems[i], kSizes[i]);
+                    p += kSizes[i];
                 }
+                blob_header_t hdr{.format = kBlobFormat, .reserved = 0, .fields = uint16_t(kEntries), .layout_hash = kLayoutHash,
+                    .crc = crc32_ieee(g_Blob.data() + sizeof(blob_header_t), kBlobSize - sizeof(blob_header_t))};
+                std::memcpy(g_Blob.data(), &hdr, sizeof(hdr));
+                return kBlobSize;
+            }
+
+            static int save_blob()
+            {
+                int rc = settings_save_one(kCfg.blob_name, g_Blob.data(), serialize_blob());
+                if (rc != 0)
+                    return rc;
+                if (g_LegacyKeys)
+                {
+                    auto delete_entry = [](auto e){ settings_delete(e.name); };
+                    (delete_entry(entries),...);
+                    g_LegacyKeys = false;
+                }
+                g_BlobStale = false;
+                return 0;
+            }
+
+            //entries missing from the stored blob or stored with another size keep their current values
+            //A blob larger than kBlobCapacity (written by a firmware with more entries) is cut to its first kBlobCapacity bytes:
+            //its CRC can't be checked then, only the fields that are complete in there are taken and the blob is saved again
+            static int load_blob(size_t len, settings_read_cb read_cb, void *cb_arg)
+            {
+                if (len < sizeof(blob_header_t))
+                    return -EINVAL;
+                const bool truncated = len > kBlobCapacity;
+                const size_t read_len = truncated ? kBlobCapacity : len;
+                ssize_t rc = read_cb(cb_arg, g_Blob.data(), read_len);
+                if (rc < 0)
+                    return rc;
+                if (size_t(rc) != read_len)
+                    return -EINVAL;
+                blob_header_t hdr;
+                std::memcpy(&hdr, g_Blob.data(), sizeof(hdr));
+                const uint8_t *pDir = g_Blob.data() + sizeof(blob_header_t);
+                const uint8_t *pEnd = g_Blob.data() + read_len;
+                if (hdr.format != kBlobFormat || hdr.fields * kBlobFieldSize > size_t(pEnd - pDir))
+                    return -EINVAL;
+                const uint8_t *pData = pDir + hdr.fields * kBlobFieldSize;
+                if (!truncated && hdr.crc != crc32_ieee(pDir, len - sizeof(blob_header_t)))
+                    return -EINVAL;
+
+                g_BlobStale |= truncated || hdr.layout_hash != kLayoutHash;//legacy keys may have been loaded already
+                for(size_t f = 0; f < hdr.fields; ++f, pDir += kBlobFieldSize)
+                {
+                    uint32_t h;
+                    uint16_t sz;
+                    std::memcpy(&h, pDir, sizeof(h));
+                    std::memcpy(&sz, pDir + sizeof(h), sizeof(sz));
+                    if (sz > pEnd - pData)
+                    {
+                        if (truncated)
+                            break;//the rest was cut off
+                        return -EINVAL;
+                    }
+                    size_t i = find_by_hash(h);
+                    if (i != kNoEntry && kSizes[i] == sz)
+                        std::memcpy(kMems[i], pData, sz);
+                    pData += sz;
+                }
+                g_BlobLoaded = true;
+                return 0;
+            }
+
+            inline static std::array<uint8_t, kBlob ? kBlobCapacity : 0> g_Blob{};
+            inline static bool g_BlobStale = false;
+            inline static bool g_LegacyKeys = false;
+            inline static bool g_BlobLoaded = false;
+
+            static void mark_dirty(size_t idx)
+            {
+                zb_time_t now = ZB_TIMER_GET();
+                if (!has_unsaved())
+                    g_FirstDirty = now;
+                g_Dirty[idx / 32].fetch_or(uint32_t(1) << (idx % 32), std::memory_order_relaxed);
+                //debounce: every write postpones the batch, but not beyond write_behind_max_ms since the first unsaved write
+                uint32_t since_first = ZB_TIME_BEACON_INTERVAL_TO_MSEC(zb_time_t(now - g_FirstDirty));
+                uint32_t delay = since_first < kWriteBehindMaxMs ? std::min(kCfg.write_behind_ms, kWriteBehindMaxMs - since_first) : 0;
+                if (g_FlushAlarm.Setup(&on_flush_alarm, nullptr, delay) != RET_OK)
+                    flush();
+            }
+
+            //ZBOSS thread: flash writes may block for a while, the batch is saved from the system work queue
+            static void on_flush_alarm(void*)
+            {
+                if (k_work_submit(&g_SaveWork) < 0)
+                    save_dirty();
+            }
+
+            static void on_save_work(struct k_work *) { save_dirty(); }
+
+            //ZBOSS thread (flush) or work queue: one saver at a time, entries marked while it runs are saved by it too.
+            //Entries that failed to save are marked dirty again once it's done: the next change or flush() retries them
+            static void save_dirty()
+            {
+                if (g_Saving.exchange(true, std::memory_order_acquire))
+                    return;
+                std::array<uint32_t, kDirtyWords> failed{};
+                do
+                {
+                    std::array<uint32_t, kDirtyWords> dirty;
+                    for(size_t w = 0; w < kDirtyWords; ++w)
+                        dirty[w] = g_Dirty[w].exchange(0, std::memory_order_relaxed);
+                    if constexpr (kBlob)
+                    {
+                        if (dirty != decltype(dirty){} && save_blob() != 0)
+                        {
+                            for(size_t w = 0; w < kDirtyWords; ++w)
+                                failed[w] |= dirty[w];
+                        }
+                    }
+                    else
+                    {
+                        size_t i = 0;
+                        auto save_entry = [&](auto e){
+                            const uint32_t bit = uint32_t(1) << (i % 32);
+                            if ((dirty[i / 32] & bit) && settings_save_one(e.name, &e.mem, sizeof(std::remove_cvref_t<decltype(e.mem)>)) != 0)
+                                failed[i / 32] |= bit;
+                            ++i;
+                        };
+                        (save_entry(entries),...);
+                    }
+                    g_Saving.store(false, std::memory_order_release);
+                }while(has_unsaved() && !g_Saving.exchange(true, std::memory_order_acquire));
+                for(size_t w = 0; w < kDirtyWords; ++w)
+                {
+                    if (failed[w])
+                        g_Dirty[w].fetch_or(failed[w], std::memory_order_relaxed);
+                }
+            }
+
+            static constexpr size_t kDirtyWords = (sizeof...(entries) + 31) / 32;
+            inline static std::array<std::atomic<uint32_t>, kDirtyWords> g_Dirty{};
+            inline static std::atomic<bool> g_Saving{false};
+            inline static zb_time_t g_FirstDirty = 0;
+            inline static zb_alarm_t g_FlushAlarm;
+            inline static struct k_work g_SaveWork{.handler = &on_save_work};
         };
 }
 #endif
@@ -81,6 +81,9 @@ namespace zb
         handler_mem_t<generic_handler_t> on_steering_cancelled;
         handler_mem_t<generic_handler_t> on_formation_cancelled;
         handler_mem_t<generic_handler_t> on_ready_to_shut;
+        //called before on_ready_to_shut and on_leave, e.g. persistent_settings_manager_t<...>::flush
+        //so that write-behind settings reach flash before the device powers off or gets reset
+        simple_handler_t flush_settings = nullptr;
     };
 
     template<sig_handlers_t h = {}>
@@ -101,6 +104,7 @@ namespace zb
                 if constexpr (h.on_dev_annce) h.invoke<h.on_dev_annce>(status, ZB_ZDO_SIGNAL_GET_PARAMS(pHdr, zb_zdo_signal_device_annce_params_t));
                 break;
             case ZB_ZDO_SIGNAL_LEAVE://zb_zdo_signal_leave_params_t
+                if constexpr (h.flush_settings != nullptr) h.flush_settings();
                 if constexpr (h.on_leave) h.invoke<h.on_leave>(status, ZB_ZDO_SIGNAL_GET_PARAMS(pHdr, zb_zdo_signal_leave_params_t));
                 break;
             case ZB_ZDO_SIGNAL_ERROR:
@@ -180,6 +184,7 @@ namespace zb
                 if constexpr (h.on_formation_cancelled) h.invoke<h.on_formation_cancelled>(status);
                 break;
             case ZB_SIGNAL_READY_TO_SHUT:
+                if constexpr (h.flush_settings != nullptr) h.flush_settings();
                 if constexpr (h.on_ready_to_shut) h.invoke<h.on_ready_to_shut>(status);
                 break;
         }
@@ -14,7 +14,7 @@ namespace zb
 
         operator void*() { return pStr; }
         uint8_t size() const { return pStr[0]; }
-        std::string_view sv() const { return {pStr + 1, pStr[0]}; }
+        std::string_view sv() const { return {pStr + 1, size()}; }
 
 
         std::optional<const uint8_t*> serialize_from(const uint8_t *pSrc, size_t limit)
@@ -40,7 +40,7 @@ namespace zb
 
         operator void*() { return this; }
         uint8_t size() const { return sz; }
-        std::string_view sv() const { return {&sz + 1, sz}; }
+        std::string_view sv() const { return {&sz + 1, size()}; }
     };
 
     template<size_t N>
@@ -56,7 +56,7 @@ namespace zb
 
         operator void*() { return this; }
         uint8_t size() const { return sz; }
-        std::span<const uint8_t> sv() const { return {&sz + 1, sz}; }
+        std::span<const uint8_t> sv() const { return {&sz + 1, size()}; }
     };
 
     template<size_t N>
@@ -231,8 +231,7 @@ namespace zb
         static constexpr size_t size_bytes() { return N * sizeof(T); }
         std::span<const T> sv() const { return {data, N}; }
 
-        template<class Me>
-        auto& operator[](this Me const& t, size_t i) { return t.data[i]; }
+        auto& operator[](size_t i) const { return data[i]; }
 
         static constexpr type_t TypeId() { return type_t::OctetStr; }
         static bool TypeValidator(uint8_t *value) 
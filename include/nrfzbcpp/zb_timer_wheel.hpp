@@ -0,0 +1,392 @@
+#ifndef ZBH_TIMER_WHEEL_HPP_
+#define ZBH_TIMER_WHEEL_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <atomic>
+#include <optional>
+
+namespace zb
+{
+    //Intrusive node of the timer wheel. Embedded into zb_alarm_t.
+    struct timer_node_t
+    {
+        using tick_t = uint32_t;
+        using handler_t = void(*)(timer_node_t &n);
+
+        timer_node_t *m_pNext = nullptr;
+        timer_node_t **m_ppPrev = nullptr;//nullptr - not armed
+        tick_t m_Expires = 0;
+        tick_t m_Slack = 0;//how late the timer may fire, lets timers with overlapping windows share a wakeup
+        uint8_t m_Slot = 0;
+        handler_t m_Handler = nullptr;
+
+        bool IsArmed() const { return m_ppPrev != nullptr; }
+    };
+
+    struct index_stack_no_stats_t
+    {
+        static void cas_retry() {}
+    };
+
+    //Lock-free stack of indices [0, N) linked through a side array.
+    //The head packs the index with a tag bumped on every change, so a CAS never succeeds on a stale head (ABA).
+    //Stats policy:
+    //  static void cas_retry();             - a CAS on the head lost to another thread (benchmarks count them)
+    template<uint16_t N, class Stats = index_stack_no_stats_t>
+    struct index_stack_t
+    {
+        static_assert(N < 0xffff, "0xffff is reserved as 'empty'");
+        static constexpr uint16_t kEmpty = 0xffff;
+
+        struct full_t{};
+
+        constexpr index_stack_t() = default;
+        //all indices pushed
+        constexpr explicit index_stack_t(full_t): m_Head{pack(0, 0)}
+        {
+            for(uint16_t i = 0; i < N; ++i)
+                m_Next[i] = (i + 1 < N) ? i + 1 : kEmpty;
+        }
+
+        //returns 'true' if the stack was empty before the push
+        bool push(uint16_t i)
+        {
+            uint32_t h = m_Head.load(std::memory_order_relaxed);
+            next(i).store(index(h), std::memory_order_relaxed);
+            while(!m_Head.compare_exchange_weak(h, pack(i, tag(h) + 1), std::memory_order_release, std::memory_order_relaxed))
+            {
+                Stats::cas_retry();
+                next(i).store(index(h), std::memory_order_relaxed);
+            }
+            return index(h) == kEmpty;
+        }
+
+        std::optional<uint16_t> pop()
+        {
+            uint32_t h = m_Head.load(std::memory_order_acquire);
+            while(index(h) != kEmpty)
+            {
+                uint16_t n = next(index(h)).load(std::memory_order_relaxed);
+                if (m_Head.compare_exchange_weak(h, pack(n, tag(h) + 1), std::memory_order_acquire, std::memory_order_acquire))
+                    return index(h);
+                Stats::cas_retry();
+            }
+            return std::nullopt;
+        }
+
+        //detaches everything and calls f(i) in the push order (oldest first)
+        template<class F>
+        void pop_all_fifo(F &&f)
+        {
+            uint32_t h = m_Head.load(std::memory_order_relaxed);
+            while(!m_Head.compare_exchange_weak(h, pack(kEmpty, tag(h) + 1), std::memory_order_acquire, std::memory_order_relaxed))
+                Stats::cas_retry();
+            //the detached chain is private now: reverse it in place
+            uint16_t prev = kEmpty;
+            for(uint16_t i = index(h); i != kEmpty;)
+            {
+                uint16_t n = next(i).load(std::memory_order_relaxed);
+                next(i).store(prev, std::memory_order_relaxed);
+                prev = i;
+                i = n;
+            }
+            for(uint16_t i = prev; i != kEmpty;)
+            {
+                uint16_t n = next(i).load(std::memory_order_relaxed);
+                f(i);//f may push i back to some stack
+                i = n;
+            }
+        }
+
+        bool empty() const { return index(m_Head.load(std::memory_order_relaxed)) == kEmpty; }
+
+    private:
+        static constexpr uint32_t pack(uint16_t i, uint16_t tag) { return (uint32_t(tag) << 16) | i; }
+        static constexpr uint16_t index(uint32_t h) { return uint16_t(h); }
+        static constexpr uint16_t tag(uint32_t h) { return uint16_t(h >> 16); }
+
+        //a popper may read a link while another thread re-links the same index
+        std::atomic_ref<uint16_t> next(uint16_t i) { return std::atomic_ref<uint16_t>(m_Next[i]); }
+
+        std::atomic<uint32_t> m_Head{pack(kEmpty, 0)};
+        alignas(std::atomic_ref<uint16_t>::required_alignment) uint16_t m_Next[N] = {};
+    };
+
+    struct timer_wheel_no_lock_t
+    {
+        struct guard_t{};
+        static guard_t guard() { return {}; }
+    };
+
+    //Hierarchical timer wheel over a 32-bit tick counter (8 levels x 16 slots).
+    //A timer lives at the lowest level where its expiry shares the upper bits with the wheel time,
+    //so arm/cancel are O(1), slots of a level are ordered by time and the earliest deadline is found
+    //with a bitmap scan per level.
+    //A timer may fire anywhere in [m_Expires, m_Expires + m_Slack]: the backend alarm is scheduled at the earliest
+    //window end and every timer whose window has started by then fires in the same wakeup.
+    //
+    //Clock policy:
+    //  static tick_t now();                 - current tick
+    //  static bool schedule(tick_t delay);  - (re-)arm the single backend alarm, replacing a pending one;
+    //                                         it must call run(now()) when due. False if it could not be armed
+    //Sync policy:
+    //  static auto guard();                 - RAII guard protecting the wheel state
+    //
+    //No ZBOSS/Zephyr dependencies, so it can be driven by a virtual clock on the host.
+    template<class Clock, class Sync = timer_wheel_no_lock_t>
+    struct timer_wheel_t
+    {
+        using tick_t = timer_node_t::tick_t;
+
+        static constexpr uint8_t kSlotBits = 4;
+        static constexpr uint8_t kSlots = 1 << kSlotBits;
+        static constexpr uint8_t kLevels = sizeof(tick_t) * 8 / kSlotBits;
+        static constexpr uint8_t kDetached = 0xff;
+        //deadlines further than that are considered to be in the past (wrap-around)
+        static constexpr tick_t kMaxDelay = tick_t(-1) >> 1;
+
+        //Arms (or re-arms) the node to expire at the absolute tick 'expires' (+ up to n.m_Slack).
+        //False if the backend alarm could not be scheduled: the node is left disarmed
+        bool arm(timer_node_t &n, tick_t expires)
+        {
+            [[maybe_unused]] auto g = Sync::guard();
+            unlink(n);
+            if (empty())
+                m_Now = Clock::now();//nothing to keep consistent, catch up with the clock
+            insert(n, expires);
+            tick_t latest = window_end(n);
+            if ((!m_Scheduled || int32_t(latest - m_ScheduledAt) < 0) && !schedule_at(latest))
+            {
+                unlink(n);
+                return false;
+            }
+            return true;
+        }
+
+        //Cancel never touches the backend alarm: a spurious wakeup just re-schedules to the next due timer
+        void cancel(timer_node_t &n)
+        {
+            [[maybe_unused]] auto g = Sync::guard();
+            unlink(n);
+        }
+
+        //Expires every timer due at or before 'now' and re-schedules the backend alarm
+        void run(tick_t now)
+        {
+            {
+                //the backend alarm is re-armed once at the end, not by every callback arming a timer
+                [[maybe_unused]] auto g = Sync::guard();
+                m_Scheduled = true;
+                m_ScheduledAt = now;
+            }
+            advance(now);
+
+            //if the re-schedule fails the timers stay in: the next arm tries again
+            [[maybe_unused]] auto g = Sync::guard();
+            tick_t t = 0;
+            if (next_wakeup(t))
+                schedule_at(t);
+            else
+                m_Scheduled = false;
+        }
+
+        bool empty() const
+        {
+            for(auto m : m_Used) if (m) return false;
+            return true;
+        }
+
+        tick_t wheel_time() const { return m_Now; }
+
+    private:
+        static constexpr uint8_t slot_id(uint8_t level, uint8_t idx) { return level * kSlots + idx; }
+
+        bool schedule_at(tick_t t)
+        {
+            tick_t now = Clock::now();
+            m_Scheduled = Clock::schedule(int32_t(t - now) > 0 ? t - now : 0);
+            m_ScheduledAt = t;
+            return m_Scheduled;
+        }
+
+        void set_used(uint8_t s) { m_Used[s / kSlots] |= uint16_t(1u << (s % kSlots)); }
+        void clear_used(uint8_t s) { m_Used[s / kSlots] &= uint16_t(~(1u << (s % kSlots))); }
+
+        static void push(timer_node_t *&head, timer_node_t &n)
+        {
+            n.m_pNext = head;
+            if (head)
+                head->m_ppPrev = &n.m_pNext;
+            head = &n;
+            n.m_ppPrev = &head;
+        }
+
+        void unlink(timer_node_t &n)
+        {
+            if (!n.IsArmed())
+                return;
+            *n.m_ppPrev = n.m_pNext;
+            if (n.m_pNext)
+                n.m_pNext->m_ppPrev = n.m_ppPrev;
+            n.m_pNext = nullptr;
+            n.m_ppPrev = nullptr;
+            if (n.m_Slot != kDetached && !m_Heads[n.m_Slot])
+                clear_used(n.m_Slot);
+        }
+
+        void insert(timer_node_t &n, tick_t expires)
+        {
+            if (tick_t(expires - m_Now) > kMaxDelay)
+                expires = m_Now;
+            n.m_Expires = expires;
+            tick_t diff = expires ^ m_Now;
+            uint8_t level = diff ? (std::bit_width(diff) - 1) / kSlotBits : 0;
+            uint8_t s = slot_id(level, (expires >> (level * kSlotBits)) & (kSlots - 1));
+            n.m_Slot = s;
+            push(m_Heads[s], n);
+            set_used(s);
+        }
+
+        static tick_t window_end(timer_node_t const& n) { return n.m_Expires + (n.m_Slack > kMaxDelay ? kMaxDelay : n.m_Slack); }
+
+        //the tick at which the slot 'idx' of the level must be processed
+        tick_t slot_tick(uint8_t level, uint8_t idx) const
+        {
+            const uint8_t shift = level * kSlotBits;
+            const uint8_t cur = (m_Now >> shift) & (kSlots - 1);
+            if (!level)
+                return m_Now + ((idx - cur) & (kSlots - 1));
+            const uint8_t blockShift = shift + kSlotBits;
+            tick_t t = blockShift < 32 ? (m_Now >> blockShift) << blockShift : 0;
+            t += tick_t(idx) << shift;
+            if (idx < cur && blockShift < 32)
+                t += tick_t(1) << blockShift;//next rotation
+            return t;
+        }
+
+        //non-empty slots of the level in the time order (rotation only matters for the top level on wrap-around)
+        template<class F>
+        void for_each_slot(uint8_t level, F &&f) const
+        {
+            const uint8_t cur = (m_Now >> (level * kSlotBits)) & (kSlots - 1);
+            for(uint16_t used = std::rotr(m_Used[level], cur); used; used &= used - 1)
+            {
+                uint8_t idx = (cur + std::countr_zero(used)) & (kSlots - 1);
+                if (!f(slot_id(level, idx), slot_tick(level, idx)))
+                    break;
+            }
+        }
+
+        //the slot to be processed next; on a tie the higher level wins so that cascading goes first
+        bool next_slot(uint8_t &s, tick_t &t) const
+        {
+            bool found = false;
+            for(uint8_t level = 0; level < kLevels; ++level)
+            {
+                for_each_slot(level, [&](uint8_t ls, tick_t lt){
+                    if (!found || tick_t(lt - m_Now) <= tick_t(t - m_Now))
+                    {
+                        s = ls;
+                        t = lt;
+                        found = true;
+                    }
+                    return false;
+                });
+            }
+            return found;
+        }
+
+        //the earliest window end among all timers; slots are walked in the time order
+        //until a slot starts after the best window end found so far
+        bool next_wakeup(tick_t &w) const
+        {
+            bool found = false;
+            for(uint8_t level = 0; level < kLevels; ++level)
+            {
+                for_each_slot(level, [&](uint8_t s, tick_t st){
+                    if (found && int32_t(st - w) > 0)
+                        return false;
+                    for(auto *pN = m_Heads[s]; pN; pN = pN->m_pNext)
+                    {
+                        tick_t e = window_end(*pN);
+                        if (!found || int32_t(e - w) < 0)
+                            w = e;
+                        found = true;
+                    }
+                    return true;
+                });
+            }
+            return found;
+        }
+
+        void detach(uint8_t s, timer_node_t *&list)
+        {
+            list = m_Heads[s];
+            m_Heads[s] = nullptr;
+            clear_used(s);
+            if (list)
+                list->m_ppPrev = &list;
+            for(auto *pN = list; pN; pN = pN->m_pNext)
+                pN->m_Slot = kDetached;
+        }
+
+        void advance(tick_t now)
+        {
+            while(true)
+            {
+                timer_node_t *pExpired;
+                {
+                    [[maybe_unused]] auto g = Sync::guard();
+                    uint8_t s = 0;
+                    tick_t t = 0;
+                    if (int32_t(now - m_Now) < 0)
+                        return;
+                    if (!next_slot(s, t) || int32_t(t - now) > 0)
+                    {
+                        m_Now = now + 1;
+                        return;
+                    }
+                    m_Now = t;
+                    if (s >= kSlots)
+                    {
+                        //cascade down: everything in the slot belongs to [t, t + slot span)
+                        timer_node_t *pList;
+                        detach(s, pList);
+                        while(pList)
+                        {
+                            auto &n = *pList;
+                            unlink(n);
+                            insert(n, n.m_Expires);
+                        }
+                        continue;
+                    }
+                    detach(s, pExpired);
+                    m_Now = t + 1;
+                }
+
+                //callbacks run unlocked and may arm/cancel any timer, including the not yet fired ones from this batch
+                while(true)
+                {
+                    timer_node_t *pN;
+                    {
+                        [[maybe_unused]] auto g = Sync::guard();
+                        pN = pExpired;
+                        if (!pN)
+                            break;
+                        unlink(*pN);
+                    }
+                    pN->m_Handler(*pN);
+                }
+            }
+        }
+
+        tick_t m_Now = 0;
+        tick_t m_ScheduledAt = 0;
+        bool m_Scheduled = false;
+        uint16_t m_Used[kLevels] = {};
+        timer_node_t *m_Heads[kLevels * kSlots] = {};
+    };
+}
+#endif